@@ -106,6 +106,15 @@ namespace Sensel
         public float peak_force;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SenselUnitShift
+    {
+        public byte dims;
+        public byte force;
+        public byte angle;
+        public byte area;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     public struct SenselAccelData
     {
@@ -124,6 +133,10 @@ namespace Sensel
         public float[] force_array;
         public byte[] labels_array;
         public SenselAccelData accel_data;
+        public double timestamp;
+        public long receive_time_us;
+        public long dequeue_time_us;
+        public long scan_time_us;
     }
 
     [StructLayout(LayoutKind.Sequential)]
@@ -162,6 +175,10 @@ namespace Sensel
         protected SenselFrame frame;
         internal SenselFrameData frame_data;
 
+        public const int MAX_BATCH_FRAMES               = 16;    // Maximum number of frames returned by GetFrames
+        protected List<SenselFrame> batch_frames;
+        internal IntPtr[] batch_frame_data;
+
         public static SenselDeviceList GetDeviceList()
         {
             SenselDeviceList list = new SenselDeviceList();
@@ -175,6 +192,7 @@ namespace Sensel
             handle = new IntPtr(0);
             frame = new SenselFrame();
             frame_data = new SenselFrameData();
+            batch_frames = new List<SenselFrame>();
             sensor_info = new SenselSensorInfo();
             fw_info = new SenselFirmwareInfo();
         }
@@ -206,16 +224,33 @@ namespace Sensel
             return sensor_info;
         }
         
+        private SenselFrame NewFrame()
+        {
+            SenselFrame new_frame = new SenselFrame();
+            new_frame.contacts = new List<SenselContact>();
+            new_frame.force_array = new float[sensor_info.num_rows * sensor_info.num_cols];
+            new_frame.labels_array = new byte[sensor_info.num_rows * sensor_info.num_cols];
+            new_frame.accel_data = new SenselAccelData();
+            return new_frame;
+        }
+
         private void AllocateFrameData()
         {
-            frame.contacts = new List<SenselContact>();
-            frame.force_array = new float[sensor_info.num_rows * sensor_info.num_cols];
-            frame.labels_array = new byte[sensor_info.num_rows * sensor_info.num_cols];
-            frame.accel_data = new SenselAccelData();
+            frame = NewFrame();
             if (SenselLib.senselAllocateFrameData(handle, ref frame_data) != SenselStatus.SENSEL_OK)
                 throw SenselException();
         }
 
+        private void AllocateBatchFrameData()
+        {
+            batch_frame_data = new IntPtr[MAX_BATCH_FRAMES];
+            for (int i = 0; i < MAX_BATCH_FRAMES; i++)
+            {
+                if (SenselLib.senselAllocateFrameData(handle, ref batch_frame_data[i]) != SenselStatus.SENSEL_OK)
+                    throw SenselException();
+            }
+        }
+
         public void SetScanDetail(SenselScanDetail detail)
         {
             if (SenselLib.senselSetScanDetail(handle, detail) != SenselStatus.SENSEL_OK)
@@ -282,14 +317,38 @@ namespace Sensel
         {
             if (SenselLib.senselGetFrame(handle, frame_data) != SenselStatus.SENSEL_OK)
                 throw SenselException();
-            CopyFrameData();
+            CopyFrameData(frame_data, frame);
             return frame;
         }
 
-        private void CopyFrameData()
+        // Decodes all available frames (up to MAX_BATCH_FRAMES) with a single call into the library.
+        // The returned frames are reused by the next call to GetFrames.
+        public List<SenselFrame> GetFrames()
+        {
+            UInt32 num_frames = 0;
+            if (batch_frame_data == null)
+                AllocateBatchFrameData();
+            if (SenselLib.senselGetFrames(handle, batch_frame_data, MAX_BATCH_FRAMES, ref num_frames) != SenselStatus.SENSEL_OK)
+                throw SenselException();
+            while (batch_frames.Count < num_frames)
+                batch_frames.Add(NewFrame());
+            SenselFrameData data = new SenselFrameData();
+            for (int i = 0; i < num_frames; i++)
+            {
+                Marshal.PtrToStructure(batch_frame_data[i], data);
+                CopyFrameData(data, batch_frames[i]);
+            }
+            return batch_frames.GetRange(0, (int)num_frames);
+        }
+
+        private void CopyFrameData(SenselFrameData frame_data, SenselFrame frame)
         {
             frame.content_bit_mask = frame_data.content_bit_mask;
             frame.lost_frame_count = frame_data.lost_frame_count;
+            frame.timestamp = frame_data.timestamp;
+            frame.receive_time_us = frame_data.receive_time_us;
+            frame.dequeue_time_us = frame_data.dequeue_time_us;
+            frame.scan_time_us = frame_data.scan_time_us;
             frame.n_contacts = 0;
             if ((frame.content_bit_mask & FRAME_CONTENT_CONTACTS_MASK) > 0)
             {
@@ -42,6 +42,13 @@ namespace Sensel
         public IntPtr force_array;
         public IntPtr labels_array;
         public IntPtr accel_data;
+        public IntPtr contacts_raw;
+        public SenselUnitShift unit_shift;
+        public IntPtr contact_arrays;
+        public double timestamp;
+        public Int64 receive_time_us;
+        public Int64 dequeue_time_us;
+        public Int64 scan_time_us;
     }
 
     public static class SenselLib
@@ -74,6 +81,9 @@ namespace Sensel
         [DllImport("LibSensel.dll")]
         internal extern static SenselStatus senselAllocateFrameData(IntPtr handle, ref SenselFrameData data);
 
+        [DllImport("LibSensel.dll")]
+        internal extern static SenselStatus senselAllocateFrameData(IntPtr handle, ref IntPtr data);
+
         [DllImport("LibSensel.dll")]
         internal extern static SenselStatus senselFreeFrameData(IntPtr handle, SenselFrameData data);
         
@@ -107,6 +117,9 @@ namespace Sensel
         [DllImport("LibSensel.dll")]
         internal extern static SenselStatus senselGetFrame(IntPtr handle, SenselFrameData data);
 
+        [DllImport("LibSensel.dll")]
+        internal extern static SenselStatus senselGetFrames(IntPtr handle, IntPtr[] frames, UInt32 max_frames, ref UInt32 num_frames);
+
         [DllImport("LibSensel.dll")]
         internal extern static SenselStatus senselSetDynamicBaselineEnabled(IntPtr handle, byte val);
 
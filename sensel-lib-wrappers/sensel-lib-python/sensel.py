@@ -97,6 +97,61 @@ class SenselAccelData(Structure):
                 ("y", c_int), 
                 ("z", c_int)] 
 
+class SenselContactRaw(Structure):
+    _fields_ = [("content_bit_mask", c_ubyte),
+                ("id", c_ubyte),
+                ("state", c_ubyte),
+                ("reserved", c_ubyte),
+                ("x_pos", c_ushort),
+                ("y_pos", c_ushort),
+                ("total_force", c_ushort),
+                ("area", c_ushort),
+                ("orientation", c_short),
+                ("major_axis", c_ushort),
+                ("minor_axis", c_ushort),
+                ("delta_x", c_short),
+                ("delta_y", c_short),
+                ("delta_force", c_short),
+                ("delta_area", c_short),
+                ("min_x", c_ushort),
+                ("min_y", c_ushort),
+                ("max_x", c_ushort),
+                ("max_y", c_ushort),
+                ("peak_x", c_ushort),
+                ("peak_y", c_ushort),
+                ("peak_force", c_ushort)]
+
+class SenselUnitShift(Structure):
+    _fields_ = [("dims", c_ubyte),
+                ("force", c_ubyte),
+                ("angle", c_ubyte),
+                ("area", c_ubyte)]
+
+class SenselContactArrays(Structure):
+    _fields_ = [("content_bit_mask", c_ubyte),
+                ("n_contacts", c_ubyte),
+                ("id", POINTER(c_ubyte)),
+                ("state", POINTER(c_ubyte)),
+                ("x_pos", POINTER(c_float)),
+                ("y_pos", POINTER(c_float)),
+                ("total_force", POINTER(c_float)),
+                ("area", POINTER(c_float)),
+                ("orientation", POINTER(c_float)),
+                ("major_axis", POINTER(c_float)),
+                ("minor_axis", POINTER(c_float)),
+                ("delta_x", POINTER(c_float)),
+                ("delta_y", POINTER(c_float)),
+                ("delta_force", POINTER(c_float)),
+                ("delta_area", POINTER(c_float)),
+                ("min_x", POINTER(c_float)),
+                ("min_y", POINTER(c_float)),
+                ("max_x", POINTER(c_float)),
+                ("max_y", POINTER(c_float)),
+                ("peak_x", POINTER(c_float)),
+                ("peak_y", POINTER(c_float)),
+                ("peak_force", POINTER(c_float)),
+                ("block", c_void_p)]
+
 class SenselFrameData(Structure):
     _fields_ = [("content_bit_mask", c_ubyte),
                 ("lost_frame_count", c_int), 
@@ -104,7 +159,14 @@ class SenselFrameData(Structure):
                 ("contacts", POINTER(SenselContact)),
                 ("force_array", POINTER(c_float)),
                 ("labels_array", POINTER(c_ubyte)),
-                ("accel_data", POINTER(SenselAccelData))]
+                ("accel_data", POINTER(SenselAccelData)),
+                ("contacts_raw", POINTER(SenselContactRaw)),
+                ("unit_shift", SenselUnitShift),
+                ("contact_arrays", POINTER(SenselContactArrays)),
+                ("timestamp", c_double),
+                ("receive_time_us", c_longlong),
+                ("dequeue_time_us", c_longlong),
+                ("scan_time_us", c_longlong)]
 
 class SenselDeviceID(Structure):
     _fields_ = [("idx", c_ubyte), 
@@ -46,12 +46,13 @@
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
 #define FRAME_BUFFER_INITIAL_CAPACITY 256
+#define FRAME_SLOTS_INITIAL_CAPACITY  16
 #define DEFAULT_FRAME_CONTENT_CONTROL (FRAME_CONTENT_PRESSURE_MASK | FRAME_CONTENT_LABELS_MASK | FRAME_CONTENT_CONTACTS_MASK)
 
 #define CHECK_FREE(x) if((x)) free((x))
 
-extern sensel_protocol_cmd_t read_cmd;
-extern sensel_protocol_cmd_t write_cmd;
+// Defined with the frame views, run at the end of reads and register transactions
+void _senselDispatchFrames(SenselDevice *device);
 
 SENSEL_API
 SenselStatus WINAPI senselReadReg(SENSEL_HANDLE handle, unsigned char reg, unsigned char size, unsigned char *buf)
@@ -100,6 +101,33 @@ SenselStatus WINAPI senselWriteRegVS(SENSEL_HANDLE handle, unsigned char reg, un
   return _senselWriteRegVS(handle, &device->sensor_serial, reg, size, buf, write_size);
 }
 
+SENSEL_API
+SenselStatus WINAPI senselSetIOTimeout(SENSEL_HANDLE handle, unsigned int timeout_ms, unsigned int byte_timeout_ms)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if (!device)
+    return SENSEL_ERROR;
+
+  senselSerialSetTimeouts(&device->sensor_serial, timeout_ms, byte_timeout_ms);
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetIOTimeout(SENSEL_HANDLE handle, unsigned int *timeout_ms, unsigned int *byte_timeout_ms)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if (!device)
+    return SENSEL_ERROR;
+
+  if (timeout_ms)
+    *timeout_ms = device->sensor_serial.timeout_ms;
+  if (byte_timeout_ms)
+    *byte_timeout_ms = device->sensor_serial.byte_timeout_ms;
+  return SENSEL_OK;
+}
+
 static SenselStatus _senselGetPrvFirmwareInfo(SENSEL_HANDLE handle, SenselFirmwareInfo *fw_info)
 {
   SenselStatus           status = SENSEL_OK;
@@ -141,6 +169,28 @@ SenselStatus WINAPI senselGetSensorInfo(SENSEL_HANDLE handle, SenselSensorInfo *
   return SENSEL_OK;
 }
 
+// Allocates the contact storage the current contact format decodes into, if the frame data doesn't have it yet.
+// Frame data allocated under another format gets it on the first frame decoded in this one.
+static unsigned char _senselAllocateContactFormat(SenselDevice *device, SenselFrameData *data)
+{
+  if(device->contact_format == CONTACT_FORMAT_RAW)
+  {
+    if(!data->contacts_raw)
+      data->contacts_raw = malloc(device->sensor_info.max_contacts * sizeof(SenselContactRaw));
+    return data->contacts_raw != NULL;
+  }
+
+  if(device->contact_format == CONTACT_FORMAT_ARRAYS)
+  {
+    // The arrays themselves are allocated on first use, once the contact mask is known
+    if(!data->contact_arrays)
+      data->contact_arrays = calloc(1, sizeof(SenselContactArrays));
+    return data->contact_arrays != NULL;
+  }
+
+  return true;
+}
+
 SENSEL_API
 SenselStatus WINAPI senselAllocateFrameData(SENSEL_HANDLE handle, SenselFrameData **data)
 {
@@ -173,6 +223,10 @@ SenselStatus WINAPI senselAllocateFrameData(SENSEL_HANDLE handle, SenselFrameDat
   if (!f->accel_data)
     return SENSEL_ERROR;
 
+  f->unit_shift = device->unit_shift;
+  if (!_senselAllocateContactFormat(device, f))
+    return SENSEL_ERROR;
+
   *data = f;
 
   return SENSEL_OK;
@@ -188,6 +242,10 @@ SenselStatus WINAPI senselFreeFrameData(SENSEL_HANDLE handle, SenselFrameData *d
   CHECK_FREE(data->labels_array);
   CHECK_FREE(data->contacts);
   CHECK_FREE(data->accel_data);
+  CHECK_FREE(data->contacts_raw);
+  if (data->contact_arrays)
+    CHECK_FREE(data->contact_arrays->block);
+  CHECK_FREE(data->contact_arrays);
 
   free(data);
 
@@ -209,56 +267,9 @@ static SenselStatus _senselGetSensorNumCols(SENSEL_HANDLE handle, unsigned short
   return senselReadReg(handle, SENSEL_REG_SENSOR_NUM_COLS, 2, (unsigned char*)num_cols);
 }
 
-static SenselStatus _senselGetDimsValueScale(SENSEL_HANDLE handle, float *scale)
+static SenselStatus _senselGetUnitShift(SENSEL_HANDLE handle, unsigned char reg, unsigned char *shift)
 {
-  SenselStatus  status;
-  unsigned char reg;
-
-  status = senselReadReg(handle, SENSEL_REG_UNIT_SHIFT_DIMS, 1, &reg);
-  if (status != SENSEL_OK)
-    return status;
-
-  *scale = (float)(1 << reg);
-  return SENSEL_OK;
-}
-
-static SenselStatus _senselGetForceValueScale(SENSEL_HANDLE handle, float *scale)
-{
-  SenselStatus  status;
-  unsigned char reg;
-
-  status = senselReadReg(handle, SENSEL_REG_UNIT_SHIFT_FORCE, 1, &reg);
-  if (status != SENSEL_OK)
-    return status;
-
-  *scale = (float)(1 << reg);
-  return SENSEL_OK;
-}
-
-static SenselStatus _senselGetAngleValueScale(SENSEL_HANDLE handle, float *scale)
-{
-  SenselStatus  status;
-  unsigned char reg;
-
-  status = senselReadReg(handle, SENSEL_REG_UNIT_SHIFT_ANGLE, 1, &reg);
-  if (status != SENSEL_OK)
-    return status;
-
-  *scale = (float)(1 << reg);
-  return SENSEL_OK;
-}
-
-static SenselStatus _senselGetAreaValueScale(SENSEL_HANDLE handle, float *scale)
-{
-  SenselStatus  status;
-  unsigned char reg;
-
-  status = senselReadReg(handle, SENSEL_REG_UNIT_SHIFT_AREA, 1, &reg);
-  if (status != SENSEL_OK)
-    return status;
-
-  *scale = (float)(1 << reg);
-  return SENSEL_OK;
+  return senselReadReg(handle, reg, 1, shift);
 }
 
 static SenselStatus _senselGetSensorWidthUM(SENSEL_HANDLE handle, unsigned int *width)
@@ -410,14 +421,305 @@ SenselStatus WINAPI senselGetScanDetail(SENSEL_HANDLE handle, SenselScanDetail *
   return status;
 }
 
+#define _SENSEL_U16(p) ((unsigned short)((p)[0] | ((p)[1] << 8)))
+#define _SENSEL_S16(p) ((short)_SENSEL_U16(p))
+
+typedef unsigned char *(*SenselContactDecoder)(const SenselDevice *device, unsigned char *data_buf,
+                                                SenselContact *contacts, int num_contacts);
+
+// Defines a contact decoder for one CONTACT_MASK_* combination. The mask is a constant in each
+// decoder so the compiler drops the sections that are not present. Fields are read straight from
+// the little endian wire buffer and scaled by the reciprocals cached when the handle was opened.
+#define SENSEL_DEFINE_CONTACT_DECODER(mask)                                                      \
+static unsigned char *_senselDecodeContacts##mask(const SenselDevice *device, unsigned char *p,  \
+                                                  SenselContact *contacts, int num_contacts)     \
+{                                                                                                \
+  const float dims  = device->dims_value_inv;                                                    \
+  const float force = device->force_value_inv;                                                   \
+  const float angle = device->angle_value_inv;                                                   \
+  const float area  = device->area_value_inv;                                                    \
+                                                                                                 \
+  for(int i = 0; i < num_contacts; i++)                                                          \
+  {                                                                                              \
+    SenselContact *c = &contacts[i];                                                             \
+                                                                                                 \
+    c->content_bit_mask = (mask);                                                                \
+    c->id               = p[0];                                                                  \
+    c->state            = (unsigned int)p[1];                                                    \
+    c->x_pos            = (float)_SENSEL_U16(&p[2]) * dims;                                      \
+    c->y_pos            = (float)_SENSEL_U16(&p[4]) * dims;                                      \
+    c->total_force      = (float)_SENSEL_U16(&p[6]) * force;                                     \
+    c->area             = (float)_SENSEL_U16(&p[8]) * area;                                      \
+    p += CONTACT_DEFAULT_SEND_SIZE;                                                              \
+                                                                                                 \
+    if((mask) & CONTACT_MASK_ELLIPSE)                                                            \
+    {                                                                                            \
+      c->orientation = (float)_SENSEL_S16(&p[0]) * angle;                                        \
+      c->major_axis  = (float)_SENSEL_U16(&p[2]) * dims;                                         \
+      c->minor_axis  = (float)_SENSEL_U16(&p[4]) * dims;                                         \
+      p += CONTACT_ELLIPSE_SEND_SIZE;                                                            \
+    }                                                                                            \
+    if((mask) & CONTACT_MASK_DELTAS)                                                             \
+    {                                                                                            \
+      c->delta_x     = (float)_SENSEL_S16(&p[0]) * dims;                                         \
+      c->delta_y     = (float)_SENSEL_S16(&p[2]) * dims;                                         \
+      c->delta_force = (float)_SENSEL_S16(&p[4]) * force;                                        \
+      c->delta_area  = (float)_SENSEL_S16(&p[6]) * area;                                         \
+      p += CONTACT_DELTAS_SEND_SIZE;                                                             \
+    }                                                                                            \
+    if((mask) & CONTACT_MASK_BOUNDING_BOX)                                                       \
+    {                                                                                            \
+      c->min_x = (float)_SENSEL_U16(&p[0]) * dims;                                               \
+      c->min_y = (float)_SENSEL_U16(&p[2]) * dims;                                               \
+      c->max_x = (float)_SENSEL_U16(&p[4]) * dims;                                               \
+      c->max_y = (float)_SENSEL_U16(&p[6]) * dims;                                               \
+      p += CONTACT_BOUNDING_BOX_SEND_SIZE;                                                       \
+    }                                                                                            \
+    if((mask) & CONTACT_MASK_PEAK)                                                               \
+    {                                                                                            \
+      c->peak_x     = (float)_SENSEL_U16(&p[0]) * dims;                                          \
+      c->peak_y     = (float)_SENSEL_U16(&p[2]) * dims;                                          \
+      c->peak_force = (float)_SENSEL_U16(&p[4]) * force;                                         \
+      p += CONTACT_PEAK_SEND_SIZE;                                                               \
+    }                                                                                            \
+  }                                                                                              \
+  return p;                                                                                      \
+}
+
+SENSEL_DEFINE_CONTACT_DECODER(0)
+SENSEL_DEFINE_CONTACT_DECODER(1)
+SENSEL_DEFINE_CONTACT_DECODER(2)
+SENSEL_DEFINE_CONTACT_DECODER(3)
+SENSEL_DEFINE_CONTACT_DECODER(4)
+SENSEL_DEFINE_CONTACT_DECODER(5)
+SENSEL_DEFINE_CONTACT_DECODER(6)
+SENSEL_DEFINE_CONTACT_DECODER(7)
+SENSEL_DEFINE_CONTACT_DECODER(8)
+SENSEL_DEFINE_CONTACT_DECODER(9)
+SENSEL_DEFINE_CONTACT_DECODER(10)
+SENSEL_DEFINE_CONTACT_DECODER(11)
+SENSEL_DEFINE_CONTACT_DECODER(12)
+SENSEL_DEFINE_CONTACT_DECODER(13)
+SENSEL_DEFINE_CONTACT_DECODER(14)
+SENSEL_DEFINE_CONTACT_DECODER(15)
+
+// Indexed by contact mask
+static const SenselContactDecoder _senselContactDecoders[16] =
+{
+  _senselDecodeContacts0,  _senselDecodeContacts1,  _senselDecodeContacts2,  _senselDecodeContacts3,
+  _senselDecodeContacts4,  _senselDecodeContacts5,  _senselDecodeContacts6,  _senselDecodeContacts7,
+  _senselDecodeContacts8,  _senselDecodeContacts9,  _senselDecodeContacts10, _senselDecodeContacts11,
+  _senselDecodeContacts12, _senselDecodeContacts13, _senselDecodeContacts14, _senselDecodeContacts15,
+};
+
+// Copies contacts without conversion for CONTACT_FORMAT_RAW
+static unsigned char *_senselDecodeContactsRaw(unsigned char *p, int bit_mask, SenselContactRaw *contacts, int num_contacts)
+{
+  for(int i = 0; i < num_contacts; i++)
+  {
+    SenselContactRaw *c = &contacts[i];
+
+    c->content_bit_mask = (unsigned char)bit_mask;
+    c->id               = p[0];
+    c->state            = p[1];
+    c->reserved         = 0;
+    c->x_pos            = _SENSEL_U16(&p[2]);
+    c->y_pos            = _SENSEL_U16(&p[4]);
+    c->total_force      = _SENSEL_U16(&p[6]);
+    c->area             = _SENSEL_U16(&p[8]);
+    p += CONTACT_DEFAULT_SEND_SIZE;
+
+    if(bit_mask & CONTACT_MASK_ELLIPSE)
+    {
+      c->orientation = _SENSEL_S16(&p[0]);
+      c->major_axis  = _SENSEL_U16(&p[2]);
+      c->minor_axis  = _SENSEL_U16(&p[4]);
+      p += CONTACT_ELLIPSE_SEND_SIZE;
+    }
+    if(bit_mask & CONTACT_MASK_DELTAS)
+    {
+      c->delta_x     = _SENSEL_S16(&p[0]);
+      c->delta_y     = _SENSEL_S16(&p[2]);
+      c->delta_force = _SENSEL_S16(&p[4]);
+      c->delta_area  = _SENSEL_S16(&p[6]);
+      p += CONTACT_DELTAS_SEND_SIZE;
+    }
+    if(bit_mask & CONTACT_MASK_BOUNDING_BOX)
+    {
+      c->min_x = _SENSEL_U16(&p[0]);
+      c->min_y = _SENSEL_U16(&p[2]);
+      c->max_x = _SENSEL_U16(&p[4]);
+      c->max_y = _SENSEL_U16(&p[6]);
+      p += CONTACT_BOUNDING_BOX_SEND_SIZE;
+    }
+    if(bit_mask & CONTACT_MASK_PEAK)
+    {
+      c->peak_x     = _SENSEL_U16(&p[0]);
+      c->peak_y     = _SENSEL_U16(&p[2]);
+      c->peak_force = _SENSEL_U16(&p[4]);
+      p += CONTACT_PEAK_SEND_SIZE;
+    }
+  }
+  return p;
+}
+
+// Size on the wire of one contact sent with the given contact mask
+static int _senselContactSendSize(int bit_mask)
+{
+  int size = CONTACT_DEFAULT_SEND_SIZE;
+
+  if(bit_mask & CONTACT_MASK_ELLIPSE)      size += CONTACT_ELLIPSE_SEND_SIZE;
+  if(bit_mask & CONTACT_MASK_DELTAS)       size += CONTACT_DELTAS_SEND_SIZE;
+  if(bit_mask & CONTACT_MASK_BOUNDING_BOX) size += CONTACT_BOUNDING_BOX_SEND_SIZE;
+  if(bit_mask & CONTACT_MASK_PEAK)         size += CONTACT_PEAK_SEND_SIZE;
+  return size;
+}
+
+#define CONTACT_ARRAY_ALIGN 64
+
+// Allocates the arrays for bit_mask in a single block, each array aligned to CONTACT_ARRAY_ALIGN
+static unsigned char _senselContactArraysAlloc(SenselContactArrays *arrays, int bit_mask, int max_contacts)
+{
+  int           capacity     = (max_contacts + 15) & ~15;
+  int           float_size   = capacity * (int)sizeof(float);
+  int           byte_size    = (capacity + CONTACT_ARRAY_ALIGN - 1) & ~(CONTACT_ARRAY_ALIGN - 1);
+  int           num_floats   = 4;
+  unsigned char *block;
+  unsigned char *p;
+
+  if(bit_mask & CONTACT_MASK_ELLIPSE)      num_floats += 3;
+  if(bit_mask & CONTACT_MASK_DELTAS)       num_floats += 4;
+  if(bit_mask & CONTACT_MASK_BOUNDING_BOX) num_floats += 4;
+  if(bit_mask & CONTACT_MASK_PEAK)         num_floats += 3;
+
+  block = malloc(2 * byte_size + num_floats * float_size + CONTACT_ARRAY_ALIGN - 1);
+  if(!block)
+    return false;
+
+  CHECK_FREE(arrays->block);
+  memset(arrays, 0, sizeof(SenselContactArrays));
+  arrays->block            = block;
+  arrays->content_bit_mask = (unsigned char)bit_mask;
+
+  p = block + ((CONTACT_ARRAY_ALIGN - ((size_t)block % CONTACT_ARRAY_ALIGN)) % CONTACT_ARRAY_ALIGN);
+  arrays->id          = p; p += byte_size;
+  arrays->state       = p; p += byte_size;
+  arrays->x_pos       = (float*)p; p += float_size;
+  arrays->y_pos       = (float*)p; p += float_size;
+  arrays->total_force = (float*)p; p += float_size;
+  arrays->area        = (float*)p; p += float_size;
+  if(bit_mask & CONTACT_MASK_ELLIPSE)
+  {
+    arrays->orientation = (float*)p; p += float_size;
+    arrays->major_axis  = (float*)p; p += float_size;
+    arrays->minor_axis  = (float*)p; p += float_size;
+  }
+  if(bit_mask & CONTACT_MASK_DELTAS)
+  {
+    arrays->delta_x     = (float*)p; p += float_size;
+    arrays->delta_y     = (float*)p; p += float_size;
+    arrays->delta_force = (float*)p; p += float_size;
+    arrays->delta_area  = (float*)p; p += float_size;
+  }
+  if(bit_mask & CONTACT_MASK_BOUNDING_BOX)
+  {
+    arrays->min_x = (float*)p; p += float_size;
+    arrays->min_y = (float*)p; p += float_size;
+    arrays->max_x = (float*)p; p += float_size;
+    arrays->max_y = (float*)p; p += float_size;
+  }
+  if(bit_mask & CONTACT_MASK_PEAK)
+  {
+    arrays->peak_x     = (float*)p; p += float_size;
+    arrays->peak_y     = (float*)p; p += float_size;
+    arrays->peak_force = (float*)p; p += float_size;
+  }
+  return true;
+}
+
+// Decodes contacts for CONTACT_FORMAT_ARRAYS one field at a time, so each loop writes a single array
+static unsigned char *_senselDecodeContactArrays(const SenselDevice *device, unsigned char *data_buf, int bit_mask,
+                                                 SenselContactArrays *arrays, int num_contacts)
+{
+  const float   dims   = device->dims_value_inv;
+  const float   force  = device->force_value_inv;
+  const float   angle  = device->angle_value_inv;
+  const float   area   = device->area_value_inv;
+  const int     stride = _senselContactSendSize(bit_mask);
+  unsigned char *p     = data_buf;
+  int           i;
+
+  for(i = 0; i < num_contacts; i++, p += stride)
+  {
+    arrays->id[i]          = p[0];
+    arrays->state[i]       = p[1];
+    arrays->x_pos[i]       = (float)_SENSEL_U16(&p[2]) * dims;
+    arrays->y_pos[i]       = (float)_SENSEL_U16(&p[4]) * dims;
+    arrays->total_force[i] = (float)_SENSEL_U16(&p[6]) * force;
+    arrays->area[i]        = (float)_SENSEL_U16(&p[8]) * area;
+  }
+  p = data_buf + CONTACT_DEFAULT_SEND_SIZE;
+
+  if(bit_mask & CONTACT_MASK_ELLIPSE)
+  {
+    for(i = 0; i < num_contacts; i++)
+    {
+      unsigned char *q = p + i * stride;
+      arrays->orientation[i] = (float)_SENSEL_S16(&q[0]) * angle;
+      arrays->major_axis[i]  = (float)_SENSEL_U16(&q[2]) * dims;
+      arrays->minor_axis[i]  = (float)_SENSEL_U16(&q[4]) * dims;
+    }
+    p += CONTACT_ELLIPSE_SEND_SIZE;
+  }
+  if(bit_mask & CONTACT_MASK_DELTAS)
+  {
+    for(i = 0; i < num_contacts; i++)
+    {
+      unsigned char *q = p + i * stride;
+      arrays->delta_x[i]     = (float)_SENSEL_S16(&q[0]) * dims;
+      arrays->delta_y[i]     = (float)_SENSEL_S16(&q[2]) * dims;
+      arrays->delta_force[i] = (float)_SENSEL_S16(&q[4]) * force;
+      arrays->delta_area[i]  = (float)_SENSEL_S16(&q[6]) * area;
+    }
+    p += CONTACT_DELTAS_SEND_SIZE;
+  }
+  if(bit_mask & CONTACT_MASK_BOUNDING_BOX)
+  {
+    for(i = 0; i < num_contacts; i++)
+    {
+      unsigned char *q = p + i * stride;
+      arrays->min_x[i] = (float)_SENSEL_U16(&q[0]) * dims;
+      arrays->min_y[i] = (float)_SENSEL_U16(&q[2]) * dims;
+      arrays->max_x[i] = (float)_SENSEL_U16(&q[4]) * dims;
+      arrays->max_y[i] = (float)_SENSEL_U16(&q[6]) * dims;
+    }
+    p += CONTACT_BOUNDING_BOX_SEND_SIZE;
+  }
+  if(bit_mask & CONTACT_MASK_PEAK)
+  {
+    for(i = 0; i < num_contacts; i++)
+    {
+      unsigned char *q = p + i * stride;
+      arrays->peak_x[i]     = (float)_SENSEL_U16(&q[0]) * dims;
+      arrays->peak_y[i]     = (float)_SENSEL_U16(&q[2]) * dims;
+      arrays->peak_force[i] = (float)_SENSEL_U16(&q[4]) * force;
+    }
+  }
+
+  arrays->n_contacts = (unsigned char)num_contacts;
+  return data_buf + num_contacts * stride;
+}
+
 static unsigned char _senselParseContactFrame(SenselDevice *device, unsigned char *data_buf, int data_size,
-                                     SenselContact *contacts, unsigned char *n_contacts, int *num_bytes_read)
+                                     SenselFrameData *data, int *num_bytes_read)
 {
+  SenselContact *contacts       = data->contacts;
+  unsigned char *n_contacts     = &data->n_contacts;
   int           num_contacts    = 0;
   int           bit_mask        = 0;
   unsigned char *data_buf_start = data_buf;
 
-  if(data_size < 1)
+  if(data_size < 2)
   {
     printf("Unable to parse number of contacts (data_size == %d)\n", data_size);
     return false;
@@ -425,66 +727,53 @@ static unsigned char _senselParseContactFrame(SenselDevice *device, unsigned cha
 
   *num_bytes_read = 0;
   *n_contacts     = 0;
-  bit_mask = *data_buf;
+  if(data->contact_arrays)
+    data->contact_arrays->n_contacts = 0;
+  bit_mask = *data_buf & 0x0F;
   data_buf++;
   num_contacts = *data_buf;
   data_buf++;
   *num_bytes_read = 2;
 
-  if(num_contacts > 0)
+  if(!_senselAllocateContactFormat(device, data))
   {
-    for (int i = 0; i < num_contacts; i++) {
-      contact_raw_t prtcl_raw_contact;
-
-      memcpy(&prtcl_raw_contact, data_buf, CONTACT_DEFAULT_SEND_SIZE);
-      data_buf = data_buf + CONTACT_DEFAULT_SEND_SIZE;
-
-      contacts[i].content_bit_mask  = bit_mask;
-      contacts[i].id                = (unsigned char)prtcl_raw_contact.id;
-      contacts[i].state             = (unsigned int)prtcl_raw_contact.type;
-      contacts[i].x_pos             = (float)prtcl_raw_contact.x_pos / device->dims_value_scale;
-      contacts[i].y_pos             = (float)prtcl_raw_contact.y_pos / device->dims_value_scale;
-      contacts[i].total_force       = (float)prtcl_raw_contact.total_force / device->force_value_scale;
-      contacts[i].area              = (float)prtcl_raw_contact.area / device->area_value_scale;
-
-      if (bit_mask & CONTACT_MASK_ELLIPSE)
-      {
-        memcpy(&prtcl_raw_contact.orientation, data_buf, CONTACT_ELLIPSE_SEND_SIZE);
-        data_buf = data_buf + CONTACT_ELLIPSE_SEND_SIZE;
-
-        contacts[i].orientation = (float)prtcl_raw_contact.orientation / device->angle_value_scale;
-        contacts[i].major_axis  = (float)prtcl_raw_contact.major_axis / device->dims_value_scale;
-        contacts[i].minor_axis  = (float)prtcl_raw_contact.minor_axis / device->dims_value_scale;
-      }
-      if (bit_mask & CONTACT_MASK_DELTAS)
-      {
-        memcpy(&prtcl_raw_contact.delta_x, data_buf, CONTACT_DELTAS_SEND_SIZE);
-        data_buf = data_buf + CONTACT_DELTAS_SEND_SIZE;
+    printf("Unable to allocate contacts\n");
+    return false;
+  }
 
-        contacts[i].delta_x     = (float)prtcl_raw_contact.delta_x / device->dims_value_scale;
-        contacts[i].delta_y     = (float)prtcl_raw_contact.delta_y / device->dims_value_scale;
-        contacts[i].delta_force = (float)prtcl_raw_contact.delta_force / device->force_value_scale;
-        contacts[i].delta_area  = (float)prtcl_raw_contact.delta_area / device->area_value_scale;
-      }
-      if (bit_mask & CONTACT_MASK_BOUNDING_BOX)
-      {
-        memcpy(&prtcl_raw_contact.min_x, data_buf, CONTACT_BOUNDING_BOX_SEND_SIZE);
-        data_buf = data_buf + CONTACT_BOUNDING_BOX_SEND_SIZE;
+  if(num_contacts > 0)
+  {
+    if(num_contacts > device->sensor_info.max_contacts)
+    {
+      printf("Too many contacts in frame (%d > %d)\n", num_contacts, device->sensor_info.max_contacts);
+      return false;
+    }
+    if(num_contacts * _senselContactSendSize(bit_mask) > data_size - 2)
+    {
+      printf("Contact frame too short for %d contacts (data_size == %d)\n", num_contacts, data_size);
+      return false;
+    }
 
-        contacts[i].min_x = (float)prtcl_raw_contact.min_x / device->dims_value_scale;
-        contacts[i].min_y = (float)prtcl_raw_contact.min_y / device->dims_value_scale;
-        contacts[i].max_x = (float)prtcl_raw_contact.max_x / device->dims_value_scale;
-        contacts[i].max_y = (float)prtcl_raw_contact.max_y / device->dims_value_scale;
-      }
-      if (bit_mask & CONTACT_MASK_PEAK)
+    if(device->contact_format == CONTACT_FORMAT_RAW)
+    {
+      data_buf = _senselDecodeContactsRaw(data_buf, bit_mask, data->contacts_raw, num_contacts);
+      data->unit_shift = device->unit_shift;
+    }
+    else if(device->contact_format == CONTACT_FORMAT_ARRAYS)
+    {
+      if(!data->contact_arrays->block || data->contact_arrays->content_bit_mask != bit_mask)
       {
-        memcpy(&prtcl_raw_contact.peak_x, data_buf, CONTACT_PEAK_SEND_SIZE);
-        data_buf = data_buf + CONTACT_PEAK_SEND_SIZE;
-
-        contacts[i].peak_x      = (float)prtcl_raw_contact.peak_x / device->dims_value_scale;
-        contacts[i].peak_y      = (float)prtcl_raw_contact.peak_y / device->dims_value_scale;
-        contacts[i].peak_force  = (float)prtcl_raw_contact.peak_force / device->force_value_scale;
+        if(!_senselContactArraysAlloc(data->contact_arrays, bit_mask, device->sensor_info.max_contacts))
+        {
+          printf("Unable to allocate contact arrays\n");
+          return false;
+        }
       }
+      data_buf = _senselDecodeContactArrays(device, data_buf, bit_mask, data->contact_arrays, num_contacts);
+    }
+    else
+    {
+      data_buf = _senselContactDecoders[bit_mask](device, data_buf, contacts, num_contacts);
     }
 
     *n_contacts = num_contacts;
@@ -509,46 +798,232 @@ static unsigned char _senselParseContactFrame(SenselDevice *device, unsigned cha
   return true;
 }
 
-static unsigned char _frameBufferEnsureCapacity(SenselDevice *device, int capacity)
+static SenselFrameSlot *_frameQueueSlot(SenselDevice *device, int index)
+{
+  return &device->frame_slots[(device->frame_slots_head + index) % device->frame_slots_capacity];
+}
+
+static void _frameQueueClear(SenselDevice *device)
+{
+  device->num_buffered_frames = 0;
+  device->frame_slots_head    = 0;
+  device->skipped_frame_count = 0;
+  device->frame_view_active   = false;
+  device->frame_callback_kept = 0;
+}
+
+// Moves the queued frames to the start of a bigger buffer. This is the only time bytes are moved
+// once received, and it only happens while the buffer grows to the steady state backlog.
+static unsigned char _frameQueueGrow(SenselDevice *device, int size)
+{
+  unsigned char *new_buffer;
+  int           used = 0;
+  int           capacity;
+  int           i;
+
+  for(i = 0; i < device->num_buffered_frames; i++)
+    used += _frameQueueSlot(device, i)->size + 1;
+
+  // We allocate a buffer twice as big as what we need to avoid
+  // very numerous re-allocation. The maximum number of times
+  // we'll need to re-allocate is ln2(max_buffer_size)
+  capacity = (used + size) * 2;
+  if(capacity < device->frame_buffer_capacity * 2)
+    capacity = device->frame_buffer_capacity * 2;
+
+  new_buffer = (unsigned char*)malloc(capacity);
+  if(new_buffer == NULL)
+  {
+    printf("Unable to allocate temporary buffer!\n");
+    return false;
+  }
+
+  used = 0;
+  for(i = 0; i < device->num_buffered_frames; i++)
+  {
+    SenselFrameSlot *slot = _frameQueueSlot(device, i);
+
+    memcpy(new_buffer + used, device->frame_buffer + slot->offset, slot->size + 1);
+    slot->offset = used;
+    used += slot->size + 1;
+  }
+
+  free(device->frame_buffer);
+  device->frame_buffer          = new_buffer;
+  device->frame_buffer_capacity = capacity;
+  device->stats.buffer_reallocations++;
+  return true;
+}
+
+// Returns the offset at which size bytes can be received without touching queued frames, or -1.
+// Space is taken after the newest frame, or at the start of the buffer once the oldest frames are gone.
+static int _frameQueueReserve(SenselDevice *device, int size)
+{
+  SenselFrameSlot *oldest;
+  SenselFrameSlot *newest;
+  int             write_pos;
+
+  if(device->num_buffered_frames == 0)
+  {
+    device->frame_slots_head = 0;
+    if(device->frame_buffer_capacity < size && !_frameQueueGrow(device, size))
+      return -1;
+    return 0;
+  }
+
+  oldest    = _frameQueueSlot(device, 0);
+  newest    = _frameQueueSlot(device, device->num_buffered_frames - 1);
+  write_pos = newest->offset + newest->size + 1;
+
+  if(newest->offset >= oldest->offset)
+  {
+    // Frames are contiguous, use the end of the buffer or wrap around
+    if(device->frame_buffer_capacity - write_pos >= size)
+      return write_pos;
+    if(oldest->offset >= size)
+      return 0;
+  }
+  else if(oldest->offset - write_pos >= size)
+  {
+    // Already wrapped, use the gap before the oldest frame
+    return write_pos;
+  }
+
+  if(!_frameQueueGrow(device, size))
+    return -1;
+
+  newest = _frameQueueSlot(device, device->num_buffered_frames - 1);
+  return newest->offset + newest->size + 1;
+}
+
+// Appends a frame received at offset to the queue
+static unsigned char _frameQueuePush(SenselDevice *device, int offset, int size, long long receive_time_us)
 {
-  // If the read buffer is too small, make it bigger
-  if(device->frame_buffer_capacity < capacity)
+  SenselFrameSlot *slot;
+
+  if(device->num_buffered_frames == device->frame_slots_capacity)
   {
-    // We allocate a buffer twice as big as what we need to avoid
-    // very numerous re-allocation. By allocating a buffer
-    // twice as big as what is needed, we will be able to accomodate
-    // small increases in the data size, and the maximum number of times
-    // we'll need to re-allocate is ln2(max_buffer_size)
-    device->frame_buffer_capacity = capacity*2;
-    device->frame_buffer = (unsigned char*)realloc(device->frame_buffer, device->frame_buffer_capacity);
+    int             capacity = device->frame_slots_capacity * 2;
+    SenselFrameSlot *slots   = (SenselFrameSlot *)malloc(capacity * sizeof(SenselFrameSlot));
+    int             i;
 
-    if(device->frame_buffer == NULL)
+    if(!slots)
     {
-      printf("Unable to allocate temporary buffer!\n");
+      printf("Unable to allocate frame slots!\n");
       return false;
     }
+
+    for(i = 0; i < device->num_buffered_frames; i++)
+      slots[i] = *_frameQueueSlot(device, i);
+
+    free(device->frame_slots);
+    device->frame_slots          = slots;
+    device->frame_slots_capacity = capacity;
+    device->frame_slots_head     = 0;
+    device->stats.buffer_reallocations++;
   }
 
+  slot         = _frameQueueSlot(device, device->num_buffered_frames);
+  slot->offset          = offset;
+  slot->size            = size;
+  slot->receive_time_us = receive_time_us;
+  slot->header_parsed   = false;
+  device->num_buffered_frames++;
+
+  device->stats.frames_received++;
+  if((unsigned int)device->num_buffered_frames > device->stats.peak_queue_depth)
+    device->stats.peak_queue_depth = device->num_buffered_frames;
   return true;
 }
 
-static unsigned char _frameBufferEnsureAvailability(SenselDevice *device, int additional_capacity)
+// Drops the oldest frame
+static void _frameQueuePop(SenselDevice *device)
 {
-  return _frameBufferEnsureCapacity(device, device->frame_buffer_size + additional_capacity);
+  device->frame_slots_head = (device->frame_slots_head + 1) % device->frame_slots_capacity;
+  device->num_buffered_frames--;
+  if(device->frame_callback_kept > 0)
+    device->frame_callback_kept--;
 }
 
-static unsigned char _senselReadFrameStart(SenselDevice *device)
+// Drops the frame at index, moving the older ones up by one slot. The frame buffer is only
+// ever reclaimed from the oldest frame, so the space of a frame taken from the middle stays
+// in use until the frames before it are gone.
+static void _frameQueueRemove(SenselDevice *device, int index)
+{
+  if(index < device->frame_callback_kept)
+    device->frame_callback_kept--;
+
+  for(; index > 0; index--)
+    *_frameQueueSlot(device, index) = *_frameQueueSlot(device, index - 1);
+
+  device->frame_slots_head = (device->frame_slots_head + 1) % device->frame_slots_capacity;
+  device->num_buffered_frames--;
+}
+
+// Number of frames for senselGetFrame and the frame views. While a frame callback is set, only the
+// ones it passed over, which are always the oldest.
+static int _frameQueueAvailable(SenselDevice *device)
 {
-  unsigned char ret;
+  return device->frame_callback ? device->frame_callback_kept : device->num_buffered_frames;
+}
 
-  read_cmd.reg = SENSEL_REG_SCAN_READ_FRAME;
-  read_cmd.size = 0;
+static unsigned char _senselReadFrameStart(SenselDevice *device)
+{
+  unsigned char         ret;
+  sensel_protocol_cmd_t read_cmd = {SENSEL_READ_ADDR, SENSEL_REG_SCAN_READ_FRAME, 0x00, 0x00};
 
   ret = senselSerialWrite(&device->sensor_serial, (unsigned char *)&read_cmd, 3);
 
   return ret;
 }
 
+// Sends frame requests until count of them are in flight
+static unsigned char _senselRequestFrames(SenselDevice *device, int count)
+{
+  while(device->reads_in_flight < count)
+  {
+    if(!_senselReadFrameStart(device))
+      return false;
+    if(device->reads_in_flight++ == 0)
+      device->request_time_us = senselSerialGetTimeUS();
+  }
+  return true;
+}
+
+// Called when the first byte of the response to a frame request arrives. With read ahead, the next
+// requests go out now so that the device scans while this response is read and decoded.
+static unsigned char _senselFrameResponseStarted(SenselDevice *device)
+{
+  if(device->reads_in_flight > 0 && --device->reads_in_flight > 0)
+    device->request_time_us = senselSerialGetTimeUS();
+
+  // A pending adaptive change is written once nothing is in flight, so hold back read ahead until then
+  if(device->adaptive_buffer.enabled && device->adaptive_buffer.pending)
+    return true;
+
+  return _senselRequestFrames(device, device->read_ahead);
+}
+
+// Largest payload the sensor can send for the frame content it was asked for. A size field above it can
+// only come from a damaged header, and is rejected before any buffer space is reserved for it.
+static int _senselMaxFrameSize(SenselDevice *device)
+{
+  int content = device->frame_content_bound;
+  int cells   = device->sensor_info.num_rows * device->sensor_info.num_cols;
+  int size    = SENSEL_FRAME_HEADER_SIZE;
+
+  if(content & FRAME_CONTENT_CONTACTS_MASK)
+    size += 2 + device->sensor_info.max_contacts * _senselContactSendSize(0x0F);
+  if(content & FRAME_CONTENT_ACCEL_MASK)
+    size += sizeof(sensel_accel_data_t);
+  // The compressed maps are bounded by their uncompressed size
+  if(content & FRAME_CONTENT_PRESSURE_MASK)
+    size += cells * sizeof(float);
+  if(content & FRAME_CONTENT_LABELS_MASK)
+    size += cells * sizeof(label_t);
+  return size;
+}
+
 // This should be a static, but it's referenced externaly when in ASYNC mode
 // to clear the communication pipes
 unsigned char _senselReadFrame(SenselDevice *device)
@@ -560,6 +1035,7 @@ unsigned char _senselReadFrame(SenselDevice *device)
   unsigned char   reg;
   unsigned char   header;
   unsigned char   *frame_buffer_ptr;
+  int             frame_offset;
 
   #if(PRINT_BUFFERING_DEBUG == 1)
     unsigned char content_bit_mask;
@@ -582,18 +1058,25 @@ unsigned char _senselReadFrame(SenselDevice *device)
     return false;
   }
 
-  // Allocate enough space for the size, the data and the checksum
+  // Reject a damaged header before its size is trusted, so the resync can start right after it
+  if(reg != SENSEL_REG_SCAN_READ_FRAME || payload_size < SENSEL_FRAME_HEADER_SIZE ||
+     payload_size > _senselMaxFrameSize(device))
+  {
+    printf("SENSEL ERROR: Invalid frame header (reg %d, size %d)\n", reg, payload_size);
+    device->stats.protocol_errors++;
+    return false;
+  }
+
+  // Reserve space for the data and the checksum
   // Note: This may reallocate the buffer so the pointer to it may change
-  if(!_frameBufferEnsureAvailability(device, ((int)payload_size)+3))
+  frame_offset = _frameQueueReserve(device, ((int)payload_size)+1);
+  if(frame_offset < 0)
   {
     printf("SENSEL ERROR: Unable to allocate buffer\n");
     return false;
   }
 
-  frame_buffer_ptr = &device->frame_buffer[device->frame_buffer_size];
-
-  *((unsigned short*)frame_buffer_ptr) = payload_size;
-  frame_buffer_ptr += 2;
+  frame_buffer_ptr = &device->frame_buffer[frame_offset];
 
   if(!senselSerialReadBytes(&device->sensor_serial, frame_buffer_ptr, payload_size + 1)) //read checksum as well
   {
@@ -611,74 +1094,219 @@ unsigned char _senselReadFrame(SenselDevice *device)
   if(checksum != received_checksum)
   {
     printf("SENSEL ERROR: Checksum failed! (%d != %d) Dumping the buffer.\n", checksum, received_checksum);
+    device->stats.checksum_errors++;
     return false;
   }
 
-  device->frame_buffer_size += payload_size+2; // Grow the buffer by the payload size+2 (we don't count the checksum, so it doesn't end up in the buffer.)
-  device->num_buffered_frames++;
+  // The checksum was the last byte read, so the most recent read is when the frame arrived
+  if(!_frameQueuePush(device, frame_offset, payload_size, device->sensor_serial.rx_time_us))
+    return false;
 
   // TODO: I probably shouldn't do this debug stuff here. Instead, I should do it in the code that parses the frame
   #if(PRINT_BUFFERING_DEBUG == 1)
-    content_bit_mask = device->frame_buffer[2];
-    rolling_frame_counter = device->frame_buffer[3];
+    content_bit_mask = device->frame_buffer[frame_offset];
+    rolling_frame_counter = device->frame_buffer[frame_offset+1];
     printf("Content bit mask: %d, lost frame count: %d\n", content_bit_mask, rolling_frame_counter);
   #endif
 
   return true;
 }
 
-static unsigned char _senselReadFrames(SenselDevice *device)
+// Checks whether the 5 bytes that start a frame (ack, reg, header, size) are plausible for the scan mode
+// and the frame content
+static unsigned char _senselIsFrameStart(SenselDevice *device, unsigned char *start)
 {
-  unsigned char ack;
+  unsigned char  expected_ack = (device->scan_mode == SCAN_MODE_ASYNC) ? PT_ASYNC_DATA : PT_RVS_ACK;
+  unsigned short payload_size = (unsigned short)(start[3] | (start[4] << 8));
 
-  if(device->scan_mode == SCAN_MODE_ASYNC)
+  return start[0] == expected_ack && start[1] == SENSEL_REG_SCAN_READ_FRAME && payload_size >= SENSEL_FRAME_HEADER_SIZE &&
+         payload_size <= _senselMaxFrameSize(device);
+}
+
+// Realigns the input on the next frame after a checksum failure or an unexpected ack. The input is scanned
+// forward for a frame start whose checksum matches, and everything before it is dropped. Returns true when
+// the next byte is the ack of that frame, false when the input ran dry first.
+static unsigned char _senselResync(SenselDevice *device)
+{
+  SenselSerialHandle *serial = &device->sensor_serial;
+
+#ifdef WIN32
+  // There is no read-ahead buffer to scan on Windows, so drop everything pending instead
+  senselSerialFlushInput(serial);
+  device->stats.resyncs++;
+  return false;
+#else
+  unsigned char start[5];
+
+  for(;;)
   {
-    // NOTE: For asynchronous scanning, we peek the ack byte after the first pass.
-    // This helps us deal with the situation when there are more than one frames in the queue.
-    // NOTE: Right now, I wait for at least one frame to be available. I may want to change it
-    // so that this function returns if there are no frames available, or I may want to have an option.
-    while(senselSerialGetAvailable(&device->sensor_serial) > 0)
+    int got = senselSerialPeek(serial, start, 0, sizeof(start));
+
+    if(got < (int)sizeof(start))
     {
-      if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1))
-      {
-        printf("Failed to receive ack from sensor\n");
+      // Nothing that could start a frame arrived in time. This is also where a buffered read ends up
+      // when the damage was in its last frame, the end marker being dropped with the rest.
+      senselSerialSkip(serial, got);
+      device->stats.resyncs++;
+      return false;
+    }
+
+    if(_senselIsFrameStart(device, start))
+    {
+      int           payload_size = start[3] | (start[4] << 8);
+      int           offset       = _frameQueueReserve(device, payload_size + 1);
+      unsigned char checksum     = 0;
+      int           i;
+
+      // The candidate is peeked into the unused part of the frame buffer to verify its checksum
+      if(offset < 0)
         return false;
-      }
 
-      if(ack == PT_ASYNC_DATA)
+      got = senselSerialPeek(serial, &device->frame_buffer[offset], sizeof(start), payload_size + 1);
+      if(got < 0)
       {
-        if(!_senselReadFrame(device))
-          return false;
+        // Too big to verify ahead of time, _senselReadFrame will check it
+        device->stats.resyncs++;
+        return true;
       }
-      else
+      if(got < payload_size + 1)
       {
-        printf("SENSEL ERROR: Received %d when expecting PT_ASYNC_FRAME.\n", ack);
-          return false;
+        // Incomplete, leave it for the next read
+        device->stats.resyncs++;
+        return false;
       }
-    }
+
+      for(i = 0; i < payload_size; i++)
+        checksum += device->frame_buffer[offset + i];
+      if(checksum == device->frame_buffer[offset + payload_size])
+      {
+        device->stats.resyncs++;
+        return true;
+      }
+    }
+
+    senselSerialSkip(serial, 1);
+  }
+#endif
+}
+
+// Reads one frame, or drops it and realigns the input on the next one when it is damaged. Returns false when
+// no further frame can be read in this call.
+static unsigned char _senselReadFrameOrResync(SenselDevice *device)
+{
+  if(_senselReadFrame(device))
+    return true;
+
+  if(senselSerialIsDisconnected(&device->sensor_serial))
+    return false;
+
+  return _senselResync(device);
+}
+
+#ifndef WIN32
+// Checks, without waiting, that the next async frame or the whole response to a frame request has arrived.
+// A non-blocking read that took the start of a frame would fail on the rest and lose it. Input that doesn't
+// start a frame, or a response too big for the receive ring at its largest, is left to the read to deal with.
+// Referenced by the capture thread.
+unsigned char _senselResponseArrived(SenselDevice *device)
+{
+  SenselSerialHandle  *serial   = &device->sensor_serial;
+  unsigned char       buffered  = (device->scan_mode == SCAN_MODE_SYNC && device->scan_buffer_control > 0);
+  unsigned char       start[5];
+  int                 offset    = 0;
+  int                 got;
+
+  for(;;)
+  {
+    got = senselSerialPeekAvailable(serial, start, offset, sizeof(start));
+
+    // A buffered response ends with a single byte
+    if(got > 0 && buffered && start[0] == PT_BUFFERED_FRAME)
+      return true;
+    if(got < 0)
+      return true;
+    if(got < (int)sizeof(start))
+      return false;
+    if(!_senselIsFrameStart(device, start))
+      return true;
+
+    // Look for the checksum, the last byte of the frame
+    offset += sizeof(start) + (start[3] | (start[4] << 8)) + 1;
+    got = senselSerialPeekAvailable(serial, start, offset - 1, 1);
+    if(got < 0 || (got > 0 && !buffered))
+      return true;
+    if(got == 0)
+      return false;
+  }
+}
+#endif
+
+static unsigned char _senselReadFrames(SenselDevice *device)
+{
+  unsigned char ack;
+
+  if(device->scan_mode == SCAN_MODE_ASYNC)
+  {
+    // NOTE: For asynchronous scanning, we peek the ack byte after the first pass.
+    // This helps us deal with the situation when there are more than one frames in the queue.
+    // NOTE: Right now, I wait for at least one frame to be available. I may want to change it
+    // so that this function returns if there are no frames available, or I may want to have an option.
+    while(senselSerialGetAvailable(&device->sensor_serial) > 0)
+    {
+#ifndef WIN32
+      // Only frames that have fully arrived are taken. The rest of a partial one is waited for by the next
+      // call rather than here, so that one slow device doesn't hold up a reactor serving others.
+      if(!_senselResponseArrived(device))
+        break;
+#endif
+
+      if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1))
+      {
+        printf("Failed to receive ack from sensor\n");
+        return false;
+      }
+
+      if(ack == PT_ASYNC_DATA)
+      {
+        if(!_senselReadFrameOrResync(device))
+          return false;
+      }
+      else
+      {
+        printf("SENSEL ERROR: Received %d when expecting PT_ASYNC_FRAME.\n", ack);
+        device->stats.protocol_errors++;
+        if(!_senselResync(device))
+          return false;
+      }
+    }
   }
   else if(device->scan_buffer_control == 0)
   {
-    if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1))
+    if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1) || !_senselFrameResponseStarted(device))
     {
       printf("Failed to receive ack from sensor\n");
       return false;
     }
 
-    if(ack == PT_RVS_ACK) // Non-buffered frame
+    if(ack != PT_RVS_ACK)
     {
-      if(!_senselReadFrame(device))
+      printf("SENSEL ERROR: Received %d when expecting PT_FRAME.\n", ack);
+      device->stats.protocol_errors++;
+      if(!_senselResync(device) || !senselSerialReadBytes(&device->sensor_serial, &ack, 1))
         return false;
     }
-    else
+
+    // Non-buffered frame. A damaged one is dropped, leaving the input aligned for the next read.
+    if(!_senselReadFrame(device))
     {
-      printf("SENSEL ERROR: Received %d when expecting PT_FRAME.\n", ack);
-        return false;
+      if(!senselSerialIsDisconnected(&device->sensor_serial))
+        _senselResync(device);
+      return false;
     }
   }
   else // scan_buffer_control > 0
   {
-    if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1))
+    if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1) || !_senselFrameResponseStarted(device))
     {
       printf("Failed to receive ack from sensor\n");
       return false;
@@ -689,222 +1317,1121 @@ static unsigned char _senselReadFrames(SenselDevice *device)
       printf("Received PT_BUFFERED_FRAME(s)\n");
     #endif
 
-    // Read out buffered frames.
-    while(ack == PT_RVS_ACK)
+    for(;;)
     {
-      if(!_senselReadFrame(device))
-        return false;
+      // Read out buffered frames.
+      while(ack == PT_RVS_ACK)
+      {
+        // A damaged frame is dropped and the read continues with the next intact one
+        if(!_senselReadFrameOrResync(device))
+          return false;
 
-      if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1))
+        if(!senselSerialReadBytes(&device->sensor_serial, &ack, 1))
+        {
+          printf("SENSEL ERROR: Failed to receive ack from sensor\n");
+          return false;
+        }
+      }
+
+      if(ack == PT_BUFFERED_FRAME)
       {
-        printf("SENSEL ERROR: Failed to receive ack from sensor\n");
-        return false;
+        #if(PRINT_BUFFERING_DEBUG == 1)
+          printf("Received end of buffered frames (total of %d frames)\n", device->num_buffered_frames);
+        #endif
+        break;
       }
+
+      printf("SENSEL ERROR: Received %d when expecting PT_BUFFERED_FRAME_END.\n", ack);
+      device->stats.protocol_errors++;
+      if(!_senselResync(device) || !senselSerialReadBytes(&device->sensor_serial, &ack, 1))
+        return false;
     }
+  }
+
+  return true;
+}
+
+static void _senselAdaptiveBufferStartWindow(SenselDevice *device, long long now_us)
+{
+  SenselAdaptiveBuffer *adaptive = &device->adaptive_buffer;
+
+  adaptive->window_start_us   = now_us;
+  adaptive->window_received   = device->stats.frames_received;
+  adaptive->window_lost       = device->stats.lost_frames;
+  adaptive->window_dequeued   = 0;
+  adaptive->window_latency_us = 0;
+}
+
+// Measures the window that just ended and decides on at most one change. Runs at the end of a read, and
+// leaves writing the change to _senselAdaptiveBufferApply.
+static void _senselAdaptiveBufferUpdate(SenselDevice *device)
+{
+  SenselAdaptiveBuffer        *adaptive = &device->adaptive_buffer;
+  SenselAdaptiveBufferConfig  *config   = &adaptive->config;
+  SenselAdaptiveBufferStats   *stats    = &adaptive->stats;
+  long long                   now_us    = senselSerialGetTimeUS();
+  long long                   elapsed_us = now_us - adaptive->window_start_us;
+  unsigned long long          received;
+  unsigned long long          lost;
+  long long                   latency_us = 0;
+  unsigned char               buffers    = stats->buffers;
+  int                         frame_rate = stats->frame_rate;
+
+  if(elapsed_us < SENSEL_ADAPTIVE_BUFFER_WINDOW_US || adaptive->pending)
+    return;
+
+  // senselResetStats moved the counters back, measure again from here
+  if(device->stats.frames_received < adaptive->window_received || device->stats.lost_frames < adaptive->window_lost)
+  {
+    _senselAdaptiveBufferStartWindow(device, now_us);
+    return;
+  }
+
+  received = device->stats.frames_received - adaptive->window_received;
+  lost     = device->stats.lost_frames - adaptive->window_lost;
+
+  // A consumer that stopped dequeuing leaves no latency samples, so the oldest queued frame speaks for it
+  if(adaptive->window_dequeued > 0)
+    latency_us = adaptive->window_latency_us / adaptive->window_dequeued;
+  if(device->num_buffered_frames > 0 && now_us - _frameQueueSlot(device, 0)->receive_time_us > latency_us)
+    latency_us = now_us - _frameQueueSlot(device, 0)->receive_time_us;
+
+  stats->latency_us   = (unsigned int)latency_us;
+  stats->loss         = (received + lost > 0) ? (float)lost / (float)(received + lost) : 0.0f;
+  stats->receive_rate = (float)received * 1e6f / (float)elapsed_us;
+  stats->dequeue_rate = (float)adaptive->window_dequeued * 1e6f / (float)elapsed_us;
+  stats->queue_depth  = device->num_buffered_frames;
+  stats->last_action  = ADAPTIVE_BUFFER_HOLD;
 
-    if(ack == PT_BUFFERED_FRAME)
+  if(stats->loss > config->max_loss)
+  {
+    // The device drops frames: give it room to hold them, or scan slower once it has all it may have.
+    // Scan buffers do nothing for a device that streams frames.
+    if(buffers < config->max_buffers && device->scan_mode != SCAN_MODE_ASYNC)
     {
-      #if(PRINT_BUFFERING_DEBUG == 1)
-        printf("Received end of buffered frames (total of %d frames)\n", device->num_buffered_frames);
-      #endif
+      buffers++;
+      stats->last_action = ADAPTIVE_BUFFER_MORE_BUFFERS;
     }
-    else
+    else if(frame_rate > config->min_frame_rate)
     {
-      printf("SENSEL ERROR: Received %d when expecting PT_BUFFERED_FRAME_END.\n", ack);
+      frame_rate = frame_rate * 3 / 4;
+      stats->last_action = ADAPTIVE_BUFFER_LOWER_RATE;
+    }
+  }
+  else if(latency_us > config->target_latency_us)
+  {
+    // Frames wait too long: batch less on the device, then slow the scan down to what the application decodes
+    if(buffers > config->min_buffers && device->scan_mode != SCAN_MODE_ASYNC)
+    {
+      buffers--;
+      stats->last_action = ADAPTIVE_BUFFER_FEWER_BUFFERS;
+    }
+    else if(frame_rate > config->min_frame_rate && stats->dequeue_rate < stats->receive_rate * 0.9f)
+    {
+      // Step down no faster than the other paths, so that one slow window can't take the rate to its minimum
+      frame_rate = frame_rate * 3 / 4;
+      if(frame_rate < (int)stats->dequeue_rate)
+        frame_rate = (int)stats->dequeue_rate;
+      stats->last_action = ADAPTIVE_BUFFER_LOWER_RATE;
+    }
+  }
+  else if(lost == 0 && latency_us < config->target_latency_us / 2 && frame_rate < config->max_frame_rate)
+  {
+    frame_rate = frame_rate + frame_rate / 4 + 1;
+    stats->last_action = ADAPTIVE_BUFFER_RAISE_RATE;
+  }
+
+  if(frame_rate < config->min_frame_rate)
+    frame_rate = config->min_frame_rate;
+  if(frame_rate > config->max_frame_rate)
+    frame_rate = config->max_frame_rate;
+
+  if(buffers != stats->buffers || frame_rate != stats->frame_rate)
+  {
+    adaptive->pending            = true;
+    adaptive->pending_buffers    = buffers;
+    adaptive->pending_frame_rate = (unsigned short)frame_rate;
+  }
+
+  _senselAdaptiveBufferStartWindow(device, now_us);
+}
+
+// Writes the change decided by _senselAdaptiveBufferUpdate. Runs before a read, once the responses to
+// earlier frame requests are all in, so that the register writes don't get in the way of a frame.
+static void _senselAdaptiveBufferApply(SenselDevice *device)
+{
+  SenselAdaptiveBuffer        *adaptive = &device->adaptive_buffer;
+  SenselAdaptiveBufferStats   *stats    = &adaptive->stats;
+
+  if(!adaptive->pending || device->reads_in_flight > 0)
+    return;
+
+  if(adaptive->pending_buffers != stats->buffers &&
+     senselSetBufferControl((SENSEL_HANDLE)device, adaptive->pending_buffers) == SENSEL_OK)
+  {
+    stats->buffers = adaptive->pending_buffers;
+    stats->adjustments++;
+  }
+  if(adaptive->pending_frame_rate != stats->frame_rate &&
+     senselSetMaxFrameRate((SENSEL_HANDLE)device, adaptive->pending_frame_rate) == SENSEL_OK)
+  {
+    stats->frame_rate = adaptive->pending_frame_rate;
+    stats->adjustments++;
+  }
+
+  // Measure the new settings from here
+  adaptive->pending = false;
+  _senselAdaptiveBufferStartWindow(device, senselSerialGetTimeUS());
+}
+
+SENSEL_API
+SenselStatus WINAPI senselSetAdaptiveBufferControl(SENSEL_HANDLE handle, const SenselAdaptiveBufferConfig *config)
+{
+  SenselDevice          *device = (SenselDevice *)handle;
+  SenselAdaptiveBuffer  *adaptive;
+  unsigned char         buffers;
+  unsigned short        frame_rate;
+
+  if(!device)
+    return SENSEL_ERROR;
+
+  adaptive = &device->adaptive_buffer;
+  if(!config)
+  {
+    adaptive->enabled = false;
+    return SENSEL_OK;
+  }
+
+  if(config->min_buffers > config->max_buffers || config->min_frame_rate == 0 ||
+     config->min_frame_rate > config->max_frame_rate || config->target_latency_us == 0 || config->max_loss < 0.0f)
+    return SENSEL_ERROR;
+
+  // Start from the current settings, brought within bounds
+  buffers = device->scan_buffer_control;
+  if(buffers < config->min_buffers)
+    buffers = config->min_buffers;
+  if(buffers > config->max_buffers)
+    buffers = config->max_buffers;
+
+  if(senselGetMaxFrameRate(handle, &frame_rate) != SENSEL_OK || frame_rate > config->max_frame_rate)
+    frame_rate = config->max_frame_rate;
+  if(frame_rate < config->min_frame_rate)
+    frame_rate = config->min_frame_rate;
+
+  if(buffers != device->scan_buffer_control && senselSetBufferControl(handle, buffers) != SENSEL_OK)
+    return SENSEL_ERROR;
+  if(senselSetMaxFrameRate(handle, frame_rate) != SENSEL_OK)
+    return SENSEL_ERROR;
+
+  memset(adaptive, 0, sizeof(SenselAdaptiveBuffer));
+  adaptive->config           = *config;
+  adaptive->stats.buffers    = buffers;
+  adaptive->stats.frame_rate = frame_rate;
+  _senselAdaptiveBufferStartWindow(device, senselSerialGetTimeUS());
+  adaptive->enabled          = true;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetAdaptiveBufferStats(SENSEL_HANDLE handle, SenselAdaptiveBufferStats *stats)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(!device || !stats || !device->adaptive_buffer.enabled)
+    return SENSEL_ERROR;
+
+  *stats = device->adaptive_buffer.stats;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReadSensor(SENSEL_HANDLE handle)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(device->adaptive_buffer.enabled)
+    _senselAdaptiveBufferApply(device);
+
+  senselSerialStartTimeout(&device->sensor_serial);
+
+  if(device->scan_mode == SCAN_MODE_SYNC)
+  {
+    // If we aren't reading asynchronously, we send a start request, unless read ahead already did.
+    // Otherwise, we just wait for the data to come in.
+    if(!_senselRequestFrames(device, 1))
+    {
+      printf("Error: Couldn't initiate the start of a frame read.\n");
+      return SENSEL_ERROR;
+    }
+
+#ifndef WIN32
+    // A non-blocking read leaves a response that hasn't fully arrived in flight for the next call. One that
+    // is still missing after the default timeout is taken as lost, and the read goes on to fail on it.
+    if(device->sensor_serial.timeout_ms == 0 && !_senselResponseArrived(device) &&
+       senselSerialGetTimeUS() - device->request_time_us < SENSEL_SERIAL_DEFAULT_TIMEOUT_MS * 1000LL)
+    {
+      _senselDispatchFrames(device);
+      if(device->adaptive_buffer.enabled)
+        _senselAdaptiveBufferUpdate(device);
+      return SENSEL_OK;
+    }
+#endif
+  }
+
+  if(!_senselReadFrames(device))
+  {
+    printf("Error reading frame data.\n");
+    device->stats.failed_reads++;
+
+    // A response may be lost or still on its way. Start over with nothing in flight, dropping whatever
+    // pipelined responses come in late.
+    if(device->read_ahead > 0 && !senselSerialIsDisconnected(&device->sensor_serial))
+      senselSerialFlushInput(&device->sensor_serial);
+    device->reads_in_flight = 0;
+    _senselDispatchFrames(device);
+    return SENSEL_ERROR;
+  }
+
+  // The whole response is in, the callback is free to talk to the device
+  _senselDispatchFrames(device);
+  if(device->adaptive_buffer.enabled)
+    _senselAdaptiveBufferUpdate(device);
+  return SENSEL_OK;
+}
+
+// Reads and queues the responses to frame requests still in flight, so that a register transaction
+// doesn't take one of them for its answer. Referenced by the register functions.
+void _senselDrainFrameRequests(SenselDevice *device)
+{
+  unsigned char read_ahead = device->read_ahead;
+
+  // No new requests while draining
+  device->read_ahead = 0;
+  while(device->reads_in_flight > 0)
+  {
+    senselSerialStartTimeout(&device->sensor_serial);
+    if(!_senselReadFrames(device))
+    {
+      senselSerialFlushInput(&device->sensor_serial);
+      device->reads_in_flight = 0;
+    }
+  }
+  device->read_ahead = read_ahead;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselSetReadAhead(SENSEL_HANDLE handle, unsigned char num_frames)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(!device || num_frames > SENSEL_MAX_READ_AHEAD)
+    return SENSEL_ERROR;
+
+  device->read_ahead = num_frames;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetReadAhead(SENSEL_HANDLE handle, unsigned char *num_frames)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(!device || !num_frames)
+    return SENSEL_ERROR;
+
+  *num_frames = device->read_ahead;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselWaitForFrame(SENSEL_HANDLE handle, int timeout_ms)
+{
+  SenselDevice        *device = (SenselDevice *)handle;
+  unsigned long long  frames_received;
+  long long           deadline_us;
+
+  if(!device || !device->scanning_active)
+    return SENSEL_ERROR;
+#ifdef __linux__
+  if(device->capture && _senselCaptureIsRunning(device->capture))
+    return SENSEL_ERROR;
+#endif //__linux__
+
+  frames_received = device->stats.frames_received;
+  deadline_us     = senselSerialGetTimeUS() + (long long)timeout_ms * 1000LL;
+
+  // Frames given to the frame callback are never queued, so count received frames as well
+  while(device->num_buffered_frames == 0 && device->stats.frames_received == frames_received)
+  {
+    int remaining_ms = -1;
+
+    if(senselSerialIsDisconnected(&device->sensor_serial))
+      return SENSEL_ERROR;
+
+    if(timeout_ms >= 0)
+    {
+      long long remaining_us = deadline_us - senselSerialGetTimeUS();
+
+      remaining_ms = (remaining_us > 0) ? (int)((remaining_us + 999) / 1000) : 0;
+    }
+
+    // Asynchronous frames come on their own, so sleep until some bytes do. A synchronous read
+    // asks for a frame and blocks until the device answers.
+    if(device->scan_mode == SCAN_MODE_ASYNC)
+    {
+      int ret;
+
+#ifndef WIN32
+      // The start of a frame stays buffered until the rest arrives, so wait on the link for the rest
+      if(device->sensor_serial.rx_count > 0 && !_senselResponseArrived(device))
+        ret = senselSerialWaitForMore(&device->sensor_serial, remaining_ms);
+      else
+#endif //WIN32
+        ret = senselSerialWait(&device->sensor_serial, remaining_ms);
+
+      if(ret <= 0)
+        return SENSEL_ERROR;
+    }
+    else if(remaining_ms == 0)
+    {
+      return SENSEL_ERROR;
+    }
+
+    if(senselReadSensor(handle) != SENSEL_OK)
+      return SENSEL_ERROR;
+  }
+
+  return SENSEL_OK;
+}
+
+#ifndef WIN32
+SENSEL_API
+SenselStatus WINAPI senselGetPollFd(SENSEL_HANDLE handle, int *fd)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(!device || !fd || device->sensor_serial.serial_fd == -1)
+    return SENSEL_ERROR;
+
+  *fd = device->sensor_serial.serial_fd;
+  return SENSEL_OK;
+}
+#endif //WIN32
+
+// Returns number of frames available for reading
+SENSEL_API
+SenselStatus WINAPI senselGetNumAvailableFrames(SENSEL_HANDLE handle, unsigned int *num_frames)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  // With FRAME_QUEUE_LATEST the backlog collapses into the newest frame
+  if(device->frame_queue_policy == FRAME_QUEUE_LATEST && _frameQueueAvailable(device) > 1)
+    *num_frames = 1;
+  else
+    *num_frames = _frameQueueAvailable(device);
+  return SENSEL_OK;
+}
+
+
+// Returns the number of frames the device produced since the previous one we saw, and records this one
+static int _senselElapsedFrames(SenselDevice *device, unsigned char rolling_frame_counter)
+{
+  int elapsed_frames = (int)rolling_frame_counter - (int)device->prev_rolling_frame_counter;
+
+  if(elapsed_frames <= 0) elapsed_frames += 256;
+
+  device->prev_rolling_frame_counter = rolling_frame_counter;
+  device->stats.lost_frames += elapsed_frames - 1;
+  return elapsed_frames;
+}
+
+static void _senselClockSyncReset(SenselClockSync *sync)
+{
+  memset(sync, 0, sizeof(SenselClockSync));
+  sync->skew = 1.0;
+}
+
+// Least squares fit of the bucket minima in the window
+static void _senselClockSyncFit(SenselClockSync *sync)
+{
+  double mean_x = 0, mean_y = 0, sxx = 0, sxy = 0;
+  int    i;
+
+  if(sync->num_samples < 2)
+    return;
+
+  for(i = 0; i < sync->num_samples; i++)
+  {
+    mean_x += sync->samples[i].device_time;
+    mean_y += sync->samples[i].host_time;
+  }
+  mean_x /= sync->num_samples;
+  mean_y /= sync->num_samples;
+
+  for(i = 0; i < sync->num_samples; i++)
+  {
+    double dx = sync->samples[i].device_time - mean_x;
+    sxx += dx * dx;
+    sxy += dx * (sync->samples[i].host_time - mean_y);
+  }
+  if(sxx <= 0)
+    return;
+
+  sync->skew   = sxy / sxx;
+  sync->offset = mean_y - sync->skew * mean_x;
+  sync->valid  = true;
+}
+
+// Adds the timestamp and receive time of a frame to the model and returns the estimated host time at which
+// the frame was scanned. The receive time is returned as is until the model has been fitted.
+static long long _senselClockSyncUpdate(SenselClockSync *sync, double device_time, long long host_time_us)
+{
+  SenselClockSample sample;
+  double            host_time;
+
+  if(!sync->has_origin)
+  {
+    sync->origin_device_time  = device_time;
+    sync->origin_host_time_us = host_time_us;
+    sync->has_origin          = true;
+  }
+  sample.device_time = device_time - sync->origin_device_time;
+  sample.host_time   = (double)(host_time_us - sync->origin_host_time_us);
+
+  // Transfer and buffering only ever add delay, so the least delayed sample is the closest to the scan time
+  if(sync->bucket_frames == 0 ||
+     sample.host_time - sync->skew * sample.device_time < sync->bucket_min.host_time - sync->skew * sync->bucket_min.device_time)
+    sync->bucket_min = sample;
+
+  if(++sync->bucket_frames == SENSEL_CLOCK_SYNC_BUCKET_FRAMES)
+  {
+    sync->samples[sync->next_sample] = sync->bucket_min;
+    sync->next_sample = (sync->next_sample + 1) % SENSEL_CLOCK_SYNC_WINDOW;
+    if(sync->num_samples < SENSEL_CLOCK_SYNC_WINDOW)
+      sync->num_samples++;
+    sync->bucket_frames = 0;
+    _senselClockSyncFit(sync);
+  }
+
+  if(!sync->valid)
+    return host_time_us;
+
+  host_time = sync->skew * sample.device_time + sync->offset;
+  return sync->origin_host_time_us + (long long)(host_time >= 0 ? host_time + 0.5 : host_time - 0.5);
+}
+
+// Extends the 32 bit device timestamp to 64 bits, counting wraps between consecutive frames
+static unsigned long long _senselExtendTimestamp(SenselDevice *device, unsigned int timestamp)
+{
+  if(timestamp < device->prev_timestamp)
+    device->timestamp_wraps++;
+  device->prev_timestamp = timestamp;
+
+  return ((unsigned long long)device->timestamp_wraps << 32) | timestamp;
+}
+
+// Takes the rolling counter and timestamp of a frame into account, once and in the order frames were
+// received, and keeps the results in its slot
+static unsigned char _senselParseSlotHeader(SenselDevice *device, SenselFrameSlot *slot)
+{
+  unsigned char   *frame_data_ptr = device->frame_buffer + slot->offset;
+  unsigned int    timestamp;
+
+  if(slot->header_parsed)
+    return true;
+
+  if(slot->size < SENSEL_FRAME_HEADER_SIZE)
+  {
+    printf("Error: Frame doesn't have content bit mask and/or lost frame count.\n");
+    return false;
+  }
+
+  memcpy((unsigned char *)&timestamp, (unsigned char *)&(frame_data_ptr[2]), 4);
+  //printf("Time: %8d  /\\ = %d\n", timestamp, timestamp -prev_timestamp);
+
+  slot->elapsed_frames = _senselElapsedFrames(device, frame_data_ptr[1]);
+  slot->timestamp      = _senselExtendTimestamp(device, timestamp);
+  slot->scan_time_us   = _senselClockSyncUpdate(&device->clock_sync, (double)slot->timestamp * device->time_value_inv,
+                                                slot->receive_time_us);
+  slot->header_parsed  = true;
+  return true;
+}
+
+// Drops the oldest frame without decoding it. Only the rolling counter and timestamp are read
+// so that lost_frame_count of the next decoded frame accounts for it.
+static void _senselSkipFrame(SenselDevice *device)
+{
+  SenselFrameSlot *slot = _frameQueueSlot(device, 0);
+
+  if(_senselParseSlotHeader(device, slot))
+    device->skipped_frame_count += slot->elapsed_frames;
+
+  _frameQueuePop(device);
+}
+
+// Parses the content mask, rolling counter and timestamp at the start of a frame payload, and stamps the
+// frame with its receive and dequeue times
+static unsigned char _senselParseFrameHeader(SenselDevice *device, SenselFrameSlot *slot, SenselFrameData *data)
+{
+  if(!_senselParseSlotHeader(device, slot))
+    return false;
+
+  // Fill in frame_info. Frames skipped by senselGetLatestFrame count as lost.
+  data->content_bit_mask = device->frame_buffer[slot->offset];
+  data->lost_frame_count = slot->elapsed_frames - 1 + device->skipped_frame_count;
+  device->skipped_frame_count = 0;
+
+  data->timestamp       = (double)slot->timestamp * device->time_value_inv;
+  data->receive_time_us = slot->receive_time_us;
+  data->dequeue_time_us = senselSerialGetTimeUS();
+  data->scan_time_us    = slot->scan_time_us;
+
+  if(device->adaptive_buffer.enabled)
+  {
+    // The clock model may place a scan slightly after its dequeue right after a rate change
+    device->adaptive_buffer.window_dequeued++;
+    if(data->dequeue_time_us > data->scan_time_us)
+      device->adaptive_buffer.window_latency_us += data->dequeue_time_us - data->scan_time_us;
+  }
+
+  return true;
+}
+
+static unsigned char _senselParseAccelFrame(unsigned char *frame_data_ptr, int frame_data_size, SenselFrameData *data)
+{
+  sensel_accel_data_t prv_accel_data;
+
+  if(frame_data_size < (int)sizeof(sensel_accel_data_t))
+  {
+    printf("Unable to parse accelerometer data (data_size == %d)\n", frame_data_size);
+    return false;
+  }
+
+  memcpy(&(prv_accel_data), frame_data_ptr, sizeof(sensel_accel_data_t));
+
+  data->accel_data->x = prv_accel_data.x;
+  data->accel_data->y = prv_accel_data.y;
+  data->accel_data->z = prv_accel_data.z;
+  return true;
+}
+
+// Size of the contacts section starting at frame_data_ptr, computed from its header without decoding it
+static int _senselContactFrameSize(unsigned char *frame_data_ptr, int frame_data_size)
+{
+  if(frame_data_size < 2)
+    return -1;
+  return 2 + frame_data_ptr[1] * _senselContactSendSize(frame_data_ptr[0] & 0x0F);
+}
+
+static unsigned char _senselParseFrame(SENSEL_HANDLE handle, SenselFrameData *data)
+{
+  SenselDevice    *device = (SenselDevice*)handle;
+  SenselFrameSlot *slot;
+  unsigned char   content_bit_mask;
+  unsigned char   *frame_data_ptr;
+  int             frame_data_size = 0;
+
+  //////////////////////////////////////
+  // Locate the oldest frame
+  if(device->num_buffered_frames <= 0)
+  {
+    printf("Error: No frame in buffer.\n");
+    return false;
+  }
+
+  slot = _frameQueueSlot(device, 0);
+  frame_data_ptr = device->frame_buffer + slot->offset;
+  frame_data_size = slot->size;
+
+  if(!_senselParseFrameHeader(device, slot, data))
+    return false;
+
+  content_bit_mask = data->content_bit_mask;
+  frame_data_ptr += SENSEL_FRAME_HEADER_SIZE;
+  frame_data_size -= SENSEL_FRAME_HEADER_SIZE;
+
+	//////////////////////////////////////
+	// Extract the contacts if available
+	if (content_bit_mask & FRAME_CONTENT_CONTACTS_MASK)
+	{
+		int num_decompressed_bytes = 0;
+
+		//printf("packet size: %d, num_bytes_read: %d\n", payload_size, num_decompressed_bytes);
+
+		if (!_senselParseContactFrame(device, frame_data_ptr, frame_data_size, data, &num_decompressed_bytes))
+		{
+			printf("Error while decompressing contacts!\n");
+			return false;
+		}
+		frame_data_ptr += num_decompressed_bytes;
+		frame_data_size -= num_decompressed_bytes;
+	}
+	else
+	{
+		data->n_contacts = 0;
+		if (data->contact_arrays)
+			data->contact_arrays->n_contacts = 0;
+	}
+
+	///////////////////////////////////////////
+	// Extract accelerometer data if available
+	if (content_bit_mask & FRAME_CONTENT_ACCEL_MASK)
+	{
+		if (!_senselParseAccelFrame(frame_data_ptr, frame_data_size, data))
+			return false;
+    frame_data_ptr  += sizeof(sensel_accel_data_t);
+		frame_data_size -= sizeof(sensel_accel_data_t);
+	}
+
+#ifdef SENSEL_PRESSURE
+  //////////////////////////////////////
+  // Extract the pressure map if available
+
+  if (content_bit_mask & FRAME_CONTENT_PRESSURE_MASK || content_bit_mask & FRAME_CONTENT_LABELS_MASK)
+  {
+    unsigned int    decompress_bytes_read;
+
+    if(senselDecompressFrame(handle, frame_data_ptr, frame_data_size, content_bit_mask, data, &decompress_bytes_read))
+    {
+      printf("Error while decompressiong data\n");
       return false;
+
     }
+    frame_data_ptr  += decompress_bytes_read;
+    frame_data_size -= decompress_bytes_read;
+  }
+#else
+  frame_data_ptr  += frame_data_size;
+  frame_data_size  = 0;
+#endif // SENSEL_PRESSURE
+
+  //////////////////////////////////////
+  // Verify that the frame size was correct
+  if(frame_data_size != 0)
+  {
+    printf("Error while decompressing frame. %d unread bytes left in buffer.\n", frame_data_size);
+    return false;
+  }
+
+  return true;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetFrame(SENSEL_HANDLE handle, SenselFrameData *data)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if(_frameQueueAvailable(device) <= 0)
+  {
+    return SENSEL_ERROR;
+    printf("Error: No frames available.\n");
+  }
+
+  if(device->frame_view_active)
+    return SENSEL_ERROR;
+
+  if(device->frame_queue_policy == FRAME_QUEUE_LATEST)
+    return senselGetLatestFrame(handle, data);
+
+  if(!_senselParseFrame(handle, data))
+  {
+    // Drop the frame so that it doesn't block the ones queued behind it
+    device->stats.protocol_errors++;
+    _frameQueuePop(device);
+    return SENSEL_ERROR;
+  }
+
+  _frameQueuePop(device);
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetStats(SENSEL_HANDLE handle, SenselStats *stats)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if(!device || !stats)
+    return SENSEL_ERROR;
+
+#ifdef __linux__
+  // The capture thread updates the counters as it reads
+  if(device->capture && _senselCaptureIsRunning(device->capture))
+  {
+    _senselCaptureGetStats(device->capture, stats);
+    return SENSEL_OK;
+  }
+#endif //__linux__
+
+  *stats = device->stats;
+  stats->bytes_received = device->sensor_serial.rx_bytes;
+  stats->timeouts       = device->sensor_serial.rx_timeouts;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselResetStats(SENSEL_HANDLE handle)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if(!device)
+    return SENSEL_ERROR;
+
+  memset(&device->stats, 0, sizeof(SenselStats));
+  device->sensor_serial.rx_bytes    = 0;
+  device->sensor_serial.rx_timeouts = 0;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetHostTime(long long *time_us)
+{
+  if(!time_us)
+    return SENSEL_ERROR;
+
+  *time_us = senselSerialGetTimeUS();
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetClockModel(SENSEL_HANDLE handle, double *skew, double *offset_us)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if(!device || !skew || !offset_us || !device->clock_sync.valid)
+    return SENSEL_ERROR;
+
+  *skew      = device->clock_sync.skew;
+  *offset_us = (double)device->clock_sync.origin_host_time_us + device->clock_sync.offset -
+               device->clock_sync.skew * device->clock_sync.origin_device_time;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetLatestFrame(SENSEL_HANDLE handle, SenselFrameData *data)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if(!device || _frameQueueAvailable(device) <= 0 || device->frame_view_active)
+    return SENSEL_ERROR;
+
+  while(_frameQueueAvailable(device) > 1)
+    _senselSkipFrame(device);
+
+  if(!_senselParseFrame(handle, data))
+  {
+    device->stats.protocol_errors++;
+    _frameQueuePop(device);
+    return SENSEL_ERROR;
+  }
+
+  _frameQueuePop(device);
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetFrames(SENSEL_HANDLE handle, SenselFrameData **frames, unsigned int max_frames, unsigned int *num_frames)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+  unsigned int  count  = 0;
+
+  if(!device || !frames || !num_frames || device->frame_view_active)
+    return SENSEL_ERROR;
+
+  *num_frames = 0;
+
+  if(max_frames == 0 || _frameQueueAvailable(device) <= 0)
+    return SENSEL_OK;
+
+  if(device->frame_queue_policy == FRAME_QUEUE_LATEST)
+  {
+    if(senselGetLatestFrame(handle, frames[0]) != SENSEL_OK)
+      return SENSEL_ERROR;
+    *num_frames = 1;
+    return SENSEL_OK;
+  }
+
+  while(count < max_frames && _frameQueueAvailable(device) > 0)
+  {
+    // A frame that fails to parse is dropped and the batch carries on with the next one
+    if(_senselParseFrame(handle, frames[count]))
+      count++;
+    else
+      device->stats.protocol_errors++;
+    _frameQueuePop(device);
+  }
+
+  *num_frames = count;
+  return (count > 0) ? SENSEL_OK : SENSEL_ERROR;
+}
+
+// Views the frame at index. A frame whose header is unreadable is dropped.
+static SenselStatus _senselAcquireFrameView(SenselDevice *device, int index, SenselFrameData *data, SenselFrameView *view)
+{
+  SenselFrameSlot *slot = _frameQueueSlot(device, index);
+
+  if(!_senselParseFrameHeader(device, slot, data))
+  {
+    device->stats.protocol_errors++;
+    _frameQueueRemove(device, index);
+    return SENSEL_ERROR;
   }
 
-  return true;
+  view->content_bit_mask = data->content_bit_mask;
+  view->lost_frame_count = data->lost_frame_count;
+  view->data             = data;
+  view->decoded_mask     = 0;
+  data->n_contacts       = 0;
+  if(data->contact_arrays)
+    data->contact_arrays->n_contacts = 0;
+
+  device->frame_view_active = true;
+  device->frame_view_index  = index;
+  return SENSEL_OK;
 }
 
 SENSEL_API
-SenselStatus WINAPI senselReadSensor(SENSEL_HANDLE handle)
+SenselStatus WINAPI senselAcquireFrameView(SENSEL_HANDLE handle, SenselFrameData *data, SenselFrameView *view)
 {
-  SenselDevice *device = (SenselDevice *)handle;
-
-  if(device->scan_mode == SCAN_MODE_SYNC)
-  {
-    // If we aren't reading asynchronously, we send a start request.
-    // Otherwise, we just wait for the data to come in.
-    if(!_senselReadFrameStart(device))
-    {
-      printf("Error: Couldn't initiate the start of a frame read.\n");
-      return SENSEL_ERROR;
-    }
-  }
+  SenselDevice *device = (SenselDevice*)handle;
 
-  if(!_senselReadFrames(device))
-  {
-    printf("Error reading frame data.\n");
+  if(!device || !data || !view || device->frame_view_active || _frameQueueAvailable(device) <= 0)
     return SENSEL_ERROR;
-  }
 
-  return SENSEL_OK;
+  return _senselAcquireFrameView(device, 0, data, view);
 }
 
-// Returns number of frames available for reading
 SENSEL_API
-SenselStatus WINAPI senselGetNumAvailableFrames(SENSEL_HANDLE handle, unsigned int *num_frames)
+SenselStatus WINAPI senselFrameViewGetContacts(SENSEL_HANDLE handle, SenselFrameView *view)
 {
-  SenselDevice *device = (SenselDevice *)handle;
+  SenselDevice    *device = (SenselDevice*)handle;
+  SenselFrameSlot *slot;
+  int             num_bytes_read;
+
+  if(!device || !view || !device->frame_view_active || !(view->content_bit_mask & FRAME_CONTENT_CONTACTS_MASK))
+    return SENSEL_ERROR;
+
+  if(view->decoded_mask & FRAME_CONTENT_CONTACTS_MASK)
+    return SENSEL_OK;
+
+  slot = _frameQueueSlot(device, device->frame_view_index);
+  if(!_senselParseContactFrame(device, device->frame_buffer + slot->offset + SENSEL_FRAME_HEADER_SIZE,
+                               slot->size - SENSEL_FRAME_HEADER_SIZE, view->data, &num_bytes_read))
+    return SENSEL_ERROR;
 
-  *num_frames = device->num_buffered_frames;
+  view->decoded_mask |= FRAME_CONTENT_CONTACTS_MASK;
   return SENSEL_OK;
 }
 
-
-static unsigned char _senselParseFrame(SENSEL_HANDLE handle, SenselFrameData *data)
+// Offset of the accelerometer section of the viewed frame, or -1 if the contacts section is malformed
+static int _senselFrameViewAccelOffset(SenselDevice *device, SenselFrameView *view)
 {
-  SenselDevice    *device = (SenselDevice*)handle;
-  unsigned char   content_bit_mask;
-  unsigned char   rolling_frame_counter;
-  unsigned short  payload_size;
-  unsigned char   *frame_data_ptr;
-  unsigned int    timestamp;
-  int             frame_size;
-  int             frame_data_size = 0;
+  SenselFrameSlot *slot   = _frameQueueSlot(device, device->frame_view_index);
+  int             offset  = SENSEL_FRAME_HEADER_SIZE;
 
-  //////////////////////////////////////
-  // Extract the payload size
-  if(device->frame_buffer_size < 2)
+  if(view->content_bit_mask & FRAME_CONTENT_CONTACTS_MASK)
   {
-    printf("Error: Payload size not found in buffer.\n");
-    return false;
+    int size = _senselContactFrameSize(device->frame_buffer + slot->offset + offset, slot->size - offset);
+    if(size < 0 || offset + size > slot->size)
+      return -1;
+    offset += size;
   }
+  return offset;
+}
 
-  payload_size = *((unsigned short*)device->frame_buffer);
-  frame_size = payload_size + 2; // Size of frame (including the two payload size bytes)
+SENSEL_API
+SenselStatus WINAPI senselFrameViewGetAccel(SENSEL_HANDLE handle, SenselFrameView *view)
+{
+  SenselDevice    *device = (SenselDevice*)handle;
+  SenselFrameSlot *slot;
+  int             offset;
 
-  frame_data_ptr = device->frame_buffer + 2; // Skip the payload size
-  frame_data_size = payload_size;
+  if(!device || !view || !device->frame_view_active || !(view->content_bit_mask & FRAME_CONTENT_ACCEL_MASK))
+    return SENSEL_ERROR;
 
-  //////////////////////////////////////
-  // Extract the content bit mask and lost frame count
-  if(frame_data_size < 2)
-  {
-    printf("Error: Frame doesn't have content bit mask and/or lost frame count.\n");
-    return false;
-  }
+  if(view->decoded_mask & FRAME_CONTENT_ACCEL_MASK)
+    return SENSEL_OK;
 
-  content_bit_mask = frame_data_ptr[0];
-  rolling_frame_counter = frame_data_ptr[1];
-  //printf("%d\n", rolling_frame_counter);
+  slot   = _frameQueueSlot(device, device->frame_view_index);
+  offset = _senselFrameViewAccelOffset(device, view);
+  if(offset < 0 || !_senselParseAccelFrame(device->frame_buffer + slot->offset + offset, slot->size - offset, view->data))
+    return SENSEL_ERROR;
 
-  memcpy((unsigned char *)&timestamp, (unsigned char *)&(frame_data_ptr[2]), 4);
-  //printf("Time: %8d  /\\ = %d\n", timestamp, timestamp -prev_timestamp);
-  device->prev_timestamp = timestamp;
+  view->decoded_mask |= FRAME_CONTENT_ACCEL_MASK;
+  return SENSEL_OK;
+}
 
-  frame_data_ptr += 6;
-  frame_data_size -= 6;
+SENSEL_API
+SenselStatus WINAPI senselFrameViewGetForces(SENSEL_HANDLE handle, SenselFrameView *view)
+{
+#ifdef SENSEL_PRESSURE
+  SenselDevice    *device = (SenselDevice*)handle;
+  SenselFrameSlot *slot;
+  unsigned int    decompress_bytes_read;
+  int             offset;
 
-  // Fill in frame_info
-  int elapsed_frames = 0;
-  elapsed_frames = (int)rolling_frame_counter - (int)device->prev_rolling_frame_counter;
-  if(elapsed_frames <= 0) elapsed_frames += 256;
+  if(!device || !view || !device->frame_view_active ||
+     !(view->content_bit_mask & (FRAME_CONTENT_PRESSURE_MASK | FRAME_CONTENT_LABELS_MASK)))
+    return SENSEL_ERROR;
 
-  data->content_bit_mask = content_bit_mask;
-  data->lost_frame_count = (unsigned int)(elapsed_frames - 1);
+  if(view->decoded_mask & (FRAME_CONTENT_PRESSURE_MASK | FRAME_CONTENT_LABELS_MASK))
+    return SENSEL_OK;
 
-  device->prev_rolling_frame_counter = rolling_frame_counter;
+  slot   = _frameQueueSlot(device, device->frame_view_index);
+  offset = _senselFrameViewAccelOffset(device, view);
+  if(offset < 0)
+    return SENSEL_ERROR;
+  if(view->content_bit_mask & FRAME_CONTENT_ACCEL_MASK)
+    offset += sizeof(sensel_accel_data_t);
 
-	//////////////////////////////////////
-	// Extract the contacts if available
-	if (content_bit_mask & FRAME_CONTENT_CONTACTS_MASK)
-	{
-		int num_decompressed_bytes = 0;
+  if(senselDecompressFrame(handle, device->frame_buffer + slot->offset + offset, slot->size - offset,
+                           view->content_bit_mask, view->data, &decompress_bytes_read))
+  {
+    printf("Error while decompressiong data\n");
+    return SENSEL_ERROR;
+  }
 
-		//printf("packet size: %d, num_bytes_read: %d\n", payload_size, num_decompressed_bytes);
+  view->decoded_mask |= view->content_bit_mask & (FRAME_CONTENT_PRESSURE_MASK | FRAME_CONTENT_LABELS_MASK);
+  return SENSEL_OK;
+#else
+  return SENSEL_ERROR;
+#endif // SENSEL_PRESSURE
+}
 
-		if (!_senselParseContactFrame(device, frame_data_ptr, frame_data_size, data->contacts, &data->n_contacts, &num_decompressed_bytes))
-		{
-			printf("Error while decompressing contacts!\n");
-			return false;
-		}
-		frame_data_ptr += num_decompressed_bytes;
-		frame_data_size -= num_decompressed_bytes;
-	}
-	else
-	{
-		data->n_contacts = 0;
-	}
+SENSEL_API
+SenselStatus WINAPI senselReleaseFrameView(SENSEL_HANDLE handle, SenselFrameView *view)
+{
+  SenselDevice *device = (SenselDevice*)handle;
 
-	///////////////////////////////////////////
-	// Extract accelerometer data if available
-	if (content_bit_mask & FRAME_CONTENT_ACCEL_MASK)
-	{
-    sensel_accel_data_t prv_accel_data;
+  if(!device || !view || !device->frame_view_active)
+    return SENSEL_ERROR;
 
-		memcpy(&(prv_accel_data), frame_data_ptr, sizeof(sensel_accel_data_t));
-    frame_data_ptr  += sizeof(sensel_accel_data_t);
-		frame_data_size -= sizeof(sensel_accel_data_t);
+  _frameQueueRemove(device, device->frame_view_index);
+  device->frame_view_active = false;
+  view->data = NULL;
+  return SENSEL_OK;
+}
 
-    data->accel_data->x = prv_accel_data.x;
-    data->accel_data->y = prv_accel_data.y;
-    data->accel_data->z = prv_accel_data.z;
-	}
+// Hands the frames not yet seen by the frame callback to it, decoding only the content it asked for.
+// Frames with none of that content are passed over and stay queued for senselGetFrame. Runs once a
+// read or register transaction is over, never in the middle of one, so that the callback can use the
+// register API. Referenced by the register functions.
+void _senselDispatchFrames(SenselDevice *device)
+{
+  SENSEL_HANDLE   handle = (SENSEL_HANDLE)device;
+  SenselFrameView view;
+  int             count;
 
-#ifdef SENSEL_PRESSURE
-  //////////////////////////////////////
-  // Extract the pressure map if available
+  // A view held by the application, or by this function further up the stack when the callback
+  // itself caused a register transaction, pins its frame. The rest wait until it is released.
+  if(device->frame_view_active)
+    return;
 
-  if (content_bit_mask & FRAME_CONTENT_PRESSURE_MASK || content_bit_mask & FRAME_CONTENT_LABELS_MASK)
+  // Frames the callback's own register accesses bring in wait for the next dispatch, so that a
+  // callback slower than the frame rate can't keep this loop going forever. The callback may also
+  // clear itself, so it is checked again for every frame.
+  count = device->num_buffered_frames - device->frame_callback_kept;
+  while(count-- > 0 && device->frame_callback && device->frame_callback_kept < device->num_buffered_frames)
   {
-    unsigned int    decompress_bytes_read;
+    int             index  = device->frame_callback_kept;
+    SenselFrameSlot *slot  = _frameQueueSlot(device, index);
+    SenselFrameData *frame = device->frame_callback_frame;
+    unsigned char   wanted;
+    unsigned char   ok     = true;
+
+    // Frames are seen in order even when some are passed over, so the counter and timestamp of every
+    // one are taken into account now. Those passed over are dequeued with these values later.
+    if(!_senselParseSlotHeader(device, slot))
+    {
+      device->stats.protocol_errors++;
+      _frameQueueRemove(device, index);
+      continue;
+    }
 
-    if(senselDecompressFrame(handle, frame_data_ptr, frame_data_size, content_bit_mask, data, &decompress_bytes_read))
+    wanted = device->frame_buffer[slot->offset] & device->frame_callback_filter;
+#ifndef SENSEL_PRESSURE
+    wanted &= ~(FRAME_CONTENT_PRESSURE_MASK | FRAME_CONTENT_LABELS_MASK);
+#endif
+
+    if(!wanted)
     {
-      printf("Error while decompressiong data\n");
-      return false;
+      device->frame_callback_kept++;
+      continue;
+    }
+
+    if(_senselAcquireFrameView(device, index, frame, &view) != SENSEL_OK)
+      continue;
 
+    if(ok && (wanted & FRAME_CONTENT_CONTACTS_MASK))
+      ok = (senselFrameViewGetContacts(handle, &view) == SENSEL_OK);
+    if(ok && (wanted & FRAME_CONTENT_ACCEL_MASK))
+      ok = (senselFrameViewGetAccel(handle, &view) == SENSEL_OK);
+    if(ok && (wanted & (FRAME_CONTENT_PRESSURE_MASK | FRAME_CONTENT_LABELS_MASK)))
+      ok = (senselFrameViewGetForces(handle, &view) == SENSEL_OK);
+
+    if(ok)
+    {
+      frame->content_bit_mask = view.decoded_mask;
+      device->frame_callback(handle, frame, device->frame_callback_user_data);
+    }
+    else
+    {
+      device->stats.protocol_errors++;
     }
-    frame_data_ptr  += decompress_bytes_read;
-    frame_data_size -= decompress_bytes_read;
-  }
-#else
-  frame_data_ptr  += frame_data_size;
-  frame_data_size  = 0;
-#endif // SENSEL_PRESSURE
 
-  //////////////////////////////////////
-  // Verify that the frame size was correct
-  if(frame_data_size != 0)
-  {
-    printf("Error while decompressing frame. %d unread bytes left in buffer.\n", frame_data_size);
-    return false;
+    senselReleaseFrameView(handle, &view);
   }
+}
 
-  //////////////////////////////////////
-  // Remove the frame from the frame buffer
-  // NOTE: I use memmove instead of memcopy because memcopy results in data corruption when the two arrays overlap
-  //       I should consider just using a for-loop and copying one byte at a time for safety.
-  memmove(device->frame_buffer, device->frame_buffer+frame_size, device->frame_buffer_size-frame_size);
-  device->frame_buffer_size -= frame_size;
+SENSEL_API
+SenselStatus WINAPI senselSetFrameQueuePolicy(SENSEL_HANDLE handle, SenselFrameQueuePolicy policy)
+{
+  SenselDevice *device = (SenselDevice*)handle;
 
-  return true;
+  if(!device || (policy != FRAME_QUEUE_ALL && policy != FRAME_QUEUE_LATEST))
+    return SENSEL_ERROR;
+
+  device->frame_queue_policy = policy;
+  return SENSEL_OK;
 }
 
 SENSEL_API
-SenselStatus WINAPI senselGetFrame(SENSEL_HANDLE handle, SenselFrameData *data)
+SenselStatus WINAPI senselGetFrameQueuePolicy(SENSEL_HANDLE handle, SenselFrameQueuePolicy *policy)
 {
   SenselDevice *device = (SenselDevice*)handle;
 
-  if(device->num_buffered_frames <= 0)
-  {
+  if(!device || !policy)
     return SENSEL_ERROR;
-    printf("Error: No frames available.\n");
-  }
 
-  if(!_senselParseFrame(handle, data))
-  {
-    // TODO: Properly handle the case where we can't properly parse a frame.
-    //       We should probably delete that frame. We might want to keep frames
-    //       in separate buffers to make the error handling more robust.
+  *policy = device->frame_queue_policy;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselSetFrameCallback(SENSEL_HANDLE handle, SenselFrameCallback callback, void *user_data,
+                                           unsigned char content_filter)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if(!device)
     return SENSEL_ERROR;
-  }
 
-  device->num_buffered_frames --;
+  if(callback && !device->frame_callback_frame)
+  {
+    if(senselAllocateFrameData(handle, &device->frame_callback_frame) != SENSEL_OK)
+      return SENSEL_ERROR;
+  }
+  else if(!callback && device->frame_callback_frame)
+  {
+    senselFreeFrameData(handle, device->frame_callback_frame);
+    device->frame_callback_frame = NULL;
+  }
 
+  device->frame_callback           = callback;
+  device->frame_callback_kept      = 0;
+  device->frame_callback_user_data = user_data;
+  device->frame_callback_filter    = content_filter ? content_filter : 0xFF;
   return SENSEL_OK;
 }
 
@@ -988,9 +2515,13 @@ SenselStatus WINAPI senselStartScanning(SENSEL_HANDLE handle)
   if (device->scanning_active == true)
     return SENSEL_OK;
 
-  device->num_buffered_frames = 0;
-  device->frame_buffer_size = 0;
+  _frameQueueClear(device);
+  device->reads_in_flight            = 0;
+  device->frame_content_bound        = device->frame_content_control;
   device->prev_rolling_frame_counter = 255;
+  device->prev_timestamp             = 0;
+  device->timestamp_wraps            = 0;
+  _senselClockSyncReset(&device->clock_sync);
 
   if(device->scan_mode == SCAN_MODE_SYNC)
   {
@@ -1057,7 +2588,9 @@ SenselStatus WINAPI senselSetFrameContent(SENSEL_HANDLE handle, unsigned char co
   }
   else
   {
+    // Frames sent before the change may still be on their way
     device->frame_content_control = content;
+    device->frame_content_bound  |= content;
     return senselWriteReg(handle, SENSEL_REG_FRAME_CONTENT_CONTROL, 1, &device->frame_content_control);
   }
 }
@@ -1116,6 +2649,30 @@ SenselStatus WINAPI senselGetContactsMask(SENSEL_HANDLE handle, unsigned char *m
   return senselReadReg(handle, SENSEL_REG_CONTACTS_MASK, 1, mask);
 }
 
+SENSEL_API
+SenselStatus WINAPI senselSetContactFormat(SENSEL_HANDLE handle, SenselContactFormat format)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(!device || (format != CONTACT_FORMAT_FLOAT && format != CONTACT_FORMAT_RAW && format != CONTACT_FORMAT_ARRAYS))
+    return SENSEL_ERROR;
+
+  device->contact_format = format;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetContactFormat(SENSEL_HANDLE handle, SenselContactFormat *format)
+{
+  SenselDevice *device = (SenselDevice *)handle;
+
+  if(!device || !format)
+    return SENSEL_ERROR;
+
+  *format = device->contact_format;
+  return SENSEL_OK;
+}
+
 SENSEL_API
 SenselStatus WINAPI senselSetDynamicBaselineEnabled(SENSEL_HANDLE handle, unsigned char val)
 {
@@ -1174,8 +2731,16 @@ static SenselStatus _senselInitHandle(SENSEL_HANDLE handle)
   device->scan_buffer_control        = 0;
   device->scan_mode                  = SCAN_MODE_SYNC;
   device->num_buffered_frames        = 0;
+  device->skipped_frame_count        = 0;
+  device->frame_queue_policy         = FRAME_QUEUE_ALL;
+  device->contact_format             = CONTACT_FORMAT_FLOAT;
+  device->frame_view_active          = false;
+  device->frame_view_index           = 0;
+  device->frame_callback_kept        = 0;
   device->prev_rolling_frame_counter = 0;
   device->prev_timestamp             = 0;
+  device->timestamp_wraps            = 0;
+  _senselClockSyncReset(&device->clock_sync);
   device->dynamic_baseline_enabled   = 1;
   device->scanning_active            = false;
   device->decomp_handle              = NULL;
@@ -1216,22 +2781,38 @@ static SenselStatus _senselInitHandle(SENSEL_HANDLE handle)
   if(status != SENSEL_OK)
     return status;
 
-  status = _senselGetDimsValueScale(handle, &device->dims_value_scale);
+  status = _senselGetUnitShift(handle, SENSEL_REG_UNIT_SHIFT_DIMS, &device->unit_shift.dims);
   if (status != SENSEL_OK)
     return status;
 
-  status = _senselGetForceValueScale(handle, &device->force_value_scale);
+  status = _senselGetUnitShift(handle, SENSEL_REG_UNIT_SHIFT_FORCE, &device->unit_shift.force);
   if (status != SENSEL_OK)
     return status;
 
-  status = _senselGetAngleValueScale(handle, &device->angle_value_scale);
+  status = _senselGetUnitShift(handle, SENSEL_REG_UNIT_SHIFT_ANGLE, &device->unit_shift.angle);
   if (status != SENSEL_OK)
     return status;
 
-  status = _senselGetAreaValueScale(handle, &device->area_value_scale);
+  status = _senselGetUnitShift(handle, SENSEL_REG_UNIT_SHIFT_AREA, &device->unit_shift.area);
   if (status != SENSEL_OK)
     return status;
 
+  device->dims_value_scale  = (float)(1 << device->unit_shift.dims);
+  device->force_value_scale = (float)(1 << device->unit_shift.force);
+  device->angle_value_scale = (float)(1 << device->unit_shift.angle);
+  device->area_value_scale  = (float)(1 << device->unit_shift.area);
+
+  // Older firmware may not report a time unit, in which case timestamps are left unscaled
+  if (_senselGetUnitShift(handle, SENSEL_REG_UNIT_SHIFT_TIME, &device->time_shift) != SENSEL_OK)
+    device->time_shift = 0;
+  device->time_value_inv = 1.0 / (double)(1ULL << device->time_shift);
+
+  // Scales are powers of two, so multiplying by the reciprocal is exact
+  device->dims_value_inv  = 1.0f / device->dims_value_scale;
+  device->force_value_inv = 1.0f / device->force_value_scale;
+  device->angle_value_inv = 1.0f / device->angle_value_scale;
+  device->area_value_inv  = 1.0f / device->area_value_scale;
+
   unsigned int width;
   status = _senselGetSensorWidthUM(handle, &width);
   if (status != SENSEL_OK)
@@ -1257,7 +2838,15 @@ static SenselStatus _senselInitHandle(SENSEL_HANDLE handle)
     return SENSEL_ERROR;
   }
   device->frame_buffer_capacity = FRAME_BUFFER_INITIAL_CAPACITY;
-  device->frame_buffer_size = 0;
+
+  device->frame_slots = (SenselFrameSlot*)malloc(FRAME_SLOTS_INITIAL_CAPACITY*sizeof(SenselFrameSlot));
+  if(!device->frame_slots)
+  {
+    printf("Error allocating frame slots.\n");
+    return SENSEL_ERROR;
+  }
+  device->frame_slots_capacity = FRAME_SLOTS_INITIAL_CAPACITY;
+  _frameQueueClear(device);
 
   // Init LED related settings
   status = senselGetNumAvailableLEDs(handle, &device->num_leds);
@@ -1301,6 +2890,23 @@ SenselStatus WINAPI senselGetDeviceList(SenselDeviceList *list)
   return SENSEL_OK;
 }
 
+// Frees the memory allocated by _senselInitHandle, which may have failed part way
+static void _senselFreeHandleBuffers(SenselDevice *device)
+{
+  CHECK_FREE(device->frame_buffer);
+  CHECK_FREE(device->frame_slots);
+  CHECK_FREE(device->led_array);
+  device->frame_buffer = NULL;
+  device->frame_slots  = NULL;
+  device->led_array    = NULL;
+
+#ifdef SENSEL_PRESSURE
+  if (device->decomp_handle)
+    senselFreeDecompressionHandle(device);
+  device->decomp_handle = NULL;
+#endif //SENSEL_PRESSURE
+}
+
 SENSEL_API
 SenselStatus WINAPI senselSoftReset(SENSEL_HANDLE handle)
 {
@@ -1317,15 +2923,9 @@ SenselStatus WINAPI senselSoftReset(SENSEL_HANDLE handle)
 
   /*
    * Any memory allocated in _senselInitHandle must be cleared here to ensure
-   * no memory leak.
+   * no memory leak. They are cleared in case _senselInitHandle fails before allocating them again.
    */
-  CHECK_FREE(device->frame_buffer);
-  CHECK_FREE(device->led_array);
-
-#ifdef SENSEL_PRESSURE
-  if (device->decomp_handle)
-    senselFreeDecompressionHandle(handle);
-#endif //SENSEL_PRESSURE
+  _senselFreeHandleBuffers(device);
 
   return _senselInitHandle(handle);
 }
@@ -1349,13 +2949,16 @@ SenselStatus WINAPI senselOpenDeviceByID(SENSEL_HANDLE *handle, unsigned char id
   if (status != SENSEL_OK)
   {
     printf("Error resetting sensor settings.\n");
+    senselSerialClose(&device->sensor_serial);
     goto error;
   }
 
   return SENSEL_OK;
 
 error:
+  _senselFreeHandleBuffers(device);
   free(device);
+  *handle = NULL;
   return SENSEL_ERROR;
 }
 
@@ -1378,13 +2981,16 @@ SenselStatus WINAPI senselOpenDeviceBySerialNum(SENSEL_HANDLE *handle, unsigned
   if (status != SENSEL_OK)
   {
     printf("Error resetting sensor settings.\n");
+    senselSerialClose(&device->sensor_serial);
     goto error;
   }
 
   return SENSEL_OK;
 
 error:
+  _senselFreeHandleBuffers(device);
   free(device);
+  *handle = NULL;
   return SENSEL_ERROR;
 }
 
@@ -1407,13 +3013,48 @@ SenselStatus WINAPI senselOpenDeviceByComPort(SENSEL_HANDLE *handle, unsigned ch
   if (status != SENSEL_OK)
   {
     printf("Error resetting sensor settings.\n");
+    senselSerialClose(&device->sensor_serial);
+    goto error;
+  }
+
+  return SENSEL_OK;
+
+error:
+  _senselFreeHandleBuffers(device);
+  free(device);
+  *handle = NULL;
+  return SENSEL_ERROR;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselOpenDeviceByTransport(SENSEL_HANDLE *handle, SenselTransportType type, const char *address)
+{
+  SenselStatus status   = SENSEL_OK;
+  SenselDevice *device  = malloc(sizeof(SenselDevice));
+
+  if (!device)
+    return SENSEL_ERROR;
+
+  memset(device, 0, sizeof(SenselDevice));
+  *handle = device;
+
+  if (!senselSerialOpenTransport(&device->sensor_serial, type, (char*)address))
+    goto error;
+
+  status = senselSoftReset(*handle);
+  if (status != SENSEL_OK)
+  {
+    printf("Error resetting sensor settings.\n");
+    senselSerialClose(&device->sensor_serial);
     goto error;
   }
 
   return SENSEL_OK;
 
 error:
+  _senselFreeHandleBuffers(device);
   free(device);
+  *handle = NULL;
   return SENSEL_ERROR;
 }
 
@@ -1437,13 +3078,16 @@ SenselStatus WINAPI senselOpen(SENSEL_HANDLE *handle)
   if (status != SENSEL_OK)
   {
     printf("Error resetting sensor settings.\n");
+    senselSerialClose(&device->sensor_serial);
     goto error;
   }
 
   return SENSEL_OK;
 error:
   printf("Error\n");
+  _senselFreeHandleBuffers(device);
   free(device);
+  *handle = NULL;
   return SENSEL_ERROR;
 }
 
@@ -1452,17 +3096,34 @@ SenselStatus WINAPI senselClose(SENSEL_HANDLE handle)
 {
   SenselDevice *device = (SenselDevice*)handle;
 
+  #ifdef __linux__
+    if (device->capture)
+    {
+      senselStopCapture(handle);
+      _senselCaptureFree(device->capture);
+      device->capture = NULL;
+    }
+  #endif
+
   senselSoftReset(handle);
   senselSerialClose(&device->sensor_serial);
 
-  CHECK_FREE(device->frame_buffer);
-  CHECK_FREE(device->led_array);
-
-  #ifdef SENSEL_PRESSURE
-    if (device->decomp_handle)
-      senselFreeDecompressionHandle(handle);
-  #endif
+  _senselFreeHandleBuffers(device);
+  if (device->frame_callback_frame)
+    senselFreeFrameData(handle, device->frame_callback_frame);
 
   free(device);
   return SENSEL_OK;
 }
+
+SENSEL_API
+SenselStatus WINAPI senselIsDeviceConnected(SENSEL_HANDLE handle, unsigned char *connected)
+{
+  SenselDevice *device = (SenselDevice*)handle;
+
+  if (!device || !connected)
+    return SENSEL_ERROR;
+
+  *connected = !senselSerialIsDisconnected(&device->sensor_serial);
+  return SENSEL_OK;
+}
@@ -45,6 +45,8 @@
 #endif
 
 #define SENSEL_MAX_DEVICES             16    // Maximum number of devices supported by the API
+#define SENSEL_MAX_READ_AHEAD          2     // Maximum number of frame requests kept in flight, see senselSetReadAhead
+#define SENSEL_MAX_CAPTURE_SLOTS       4096  // Maximum number of frames a capture queue holds, see senselStartCapture
 
 #define FRAME_CONTENT_PRESSURE_MASK    0x01  // Mask indicating that the frame includes pressure data
 #define FRAME_CONTENT_LABELS_MASK      0x02  // Mask indicating that the frame includes labels data
@@ -60,6 +62,14 @@
 extern "C" {
 #endif
 
+  /*
+   * Thread safety
+   * Each handle keeps its own protocol state, so different handles can be driven from different threads
+   * at the same time, e.g. one thread per device. A single handle must not be used from two threads at once.
+   * senselGetDeviceList and the senselOpen* calls can be made from any thread. Scans are serialized,
+   * and opens use the device list of the last completed scan.
+   */
+
   /*!
    * @discussion Handle to a Sensel device
    */
@@ -84,6 +94,25 @@ extern "C" {
     SCAN_MODE_ASYNC,
   } SenselScanMode;
 
+  /*!
+   * @discussion How senselGetFrame dequeues buffered frames
+   */
+  typedef enum
+  {
+    FRAME_QUEUE_ALL    = 0,             // Every frame is decoded, oldest first
+    FRAME_QUEUE_LATEST = 1,             // Only the newest frame is decoded, older frames are dropped and counted as lost
+  } SenselFrameQueuePolicy;
+
+  /*!
+   * @discussion Backend used to talk to a device
+   */
+  typedef enum
+  {
+    SENSEL_TRANSPORT_TTY          = 0,  // Serial port, address is the device path
+    SENSEL_TRANSPORT_UNIX_SOCKET  = 1,  // Unix-domain stream socket, address is the socket path (not on Windows)
+    SENSEL_TRANSPORT_MEMORY_PIPE  = 2,  // In-process memory pipe, address is the pipe name (not on Windows)
+  } SenselTransportType;
+
   /*!
    * @discussion Describes the current state of a contact
    */
@@ -170,6 +199,108 @@ extern "C" {
     float                peak_force;         // Peak force in grams
   } SenselContact;
 
+  /*!
+   * @discussion Contact as sent by the device, filled instead of SenselContact when the contact format is
+   *              CONTACT_FORMAT_RAW. Values are fixed point: divide by (1 << shift) with the matching
+   *              SenselUnitShift field of the frame to get the units of SenselContact.
+   */
+  typedef struct
+  {
+    unsigned char        content_bit_mask;   // Mask of what contact data is valid
+    unsigned char        id;                 // Contact id
+    unsigned char        state;              // Contact state (enum SenselContactState)
+    unsigned char        reserved;
+    unsigned short       x_pos;              // unit_shift.dims
+    unsigned short       y_pos;              // unit_shift.dims
+    unsigned short       total_force;        // unit_shift.force
+    unsigned short       area;               // unit_shift.area
+
+    // CONTACT_MASK_ELLIPSE
+    short                orientation;        // unit_shift.angle
+    unsigned short       major_axis;         // unit_shift.dims
+    unsigned short       minor_axis;         // unit_shift.dims
+
+    // CONTACT_MASK_DELTAS
+    short                delta_x;            // unit_shift.dims
+    short                delta_y;            // unit_shift.dims
+    short                delta_force;        // unit_shift.force
+    short                delta_area;         // unit_shift.area
+
+    // CONTACT_MASK_BOUNDING_BOX
+    unsigned short       min_x;              // unit_shift.dims
+    unsigned short       min_y;              // unit_shift.dims
+    unsigned short       max_x;              // unit_shift.dims
+    unsigned short       max_y;              // unit_shift.dims
+
+    // CONTACT_MASK_PEAK
+    unsigned short       peak_x;             // unit_shift.dims
+    unsigned short       peak_y;             // unit_shift.dims
+    unsigned short       peak_force;         // unit_shift.force
+  } SenselContactRaw;
+
+  /*!
+   * @discussion Number of fractional bits in the fixed point contact values of SenselContactRaw
+   */
+  typedef struct
+  {
+    unsigned char dims;                // Positions and lengths
+    unsigned char force;               // Forces
+    unsigned char angle;               // Orientation
+    unsigned char area;                // Areas
+  } SenselUnitShift;
+
+  /*!
+   * @discussion Contacts of a frame stored as one array per field, filled when the contact format is
+   *              CONTACT_FORMAT_ARRAYS. Only the arrays of the contact mask the frame was sent with are
+   *              allocated, the others are NULL. Each array starts on a 64 byte boundary and is padded
+   *              to a multiple of 16 entries.
+   */
+  typedef struct
+  {
+    unsigned char        content_bit_mask;   // Mask of what contact arrays are valid
+    unsigned char        n_contacts;         // Number of contacts in each array
+    unsigned char        *id;                // Contact id
+    unsigned char        *state;             // Contact state (enum SenselContactState)
+    float                *x_pos;             // X position in mm
+    float                *y_pos;             // Y position in mm
+    float                *total_force;       // Total contact force in grams
+    float                *area;              // Area in sensor elements
+
+    // CONTACT_MASK_ELLIPSE
+    float                *orientation;       // Angle in degrees
+    float                *major_axis;        // Length of the major axis in mm
+    float                *minor_axis;        // Length of the minor axis in mm
+
+    // CONTACT_MASK_DELTAS
+    float                *delta_x;           // X contact displacement in mm
+    float                *delta_y;           // Y contact displacement in mm
+    float                *delta_force;       // Force delta in grams
+    float                *delta_area;        // Area delta in sensor elements
+
+    // CONTACT_MASK_BOUNDING_BOX
+    float                *min_x;             // Bounding box min X coordinate in mm
+    float                *min_y;             // Bounding box min Y coordinate in mm
+    float                *max_x;             // Bounding box max X coordinate in mm
+    float                *max_y;             // Bounding box max Y coordinate in mm
+
+    // CONTACT_MASK_PEAK
+    float                *peak_x;            // X position of the peak in mm
+    float                *peak_y;            // Y position of the peak in mm
+    float                *peak_force;        // Peak force in grams
+
+    void                 *block;             // Memory backing the arrays, owned by the library
+  } SenselContactArrays;
+
+  /*!
+   * @discussion Format senselGetFrame uses for contacts
+   */
+  typedef enum
+  {
+    CONTACT_FORMAT_FLOAT  = 0,         // Contacts are converted to SenselContact in data->contacts
+    CONTACT_FORMAT_RAW    = 1,         // Contacts are copied as SenselContactRaw in data->contacts_raw
+    CONTACT_FORMAT_ARRAYS = 2,         // Contacts are converted into the arrays of data->contact_arrays
+  } SenselContactFormat;
+
   /*!
    * @discussion Accelerometer information
    */
@@ -193,8 +324,95 @@ extern "C" {
     float           *force_array;      // Force image buffer
     unsigned char   *labels_array;     // Labels buffer
     SenselAccelData *accel_data;       // Accelerometer data
+    SenselContactRaw *contacts_raw;    // Array of contacts when the contact format is CONTACT_FORMAT_RAW
+    SenselUnitShift unit_shift;        // Fixed point shifts of contacts_raw
+    SenselContactArrays *contact_arrays; // Contacts when the contact format is CONTACT_FORMAT_ARRAYS
+    double          timestamp;         // Device timestamp, scaled by SENSEL_REG_UNIT_SHIFT_TIME and extended past 32 bits
+    long long       receive_time_us;   // Host time (see senselGetHostTime) at which the last byte of the frame was read
+    long long       dequeue_time_us;   // Host time at which the frame was dequeued
+    long long       scan_time_us;      // Estimated host time at which the frame was scanned, see senselGetClockModel
   } SenselFrameData;
 
+  /*!
+   * @discussion View of the oldest buffered frame, see senselAcquireFrameView.
+   *              Only the frame header is parsed when the view is acquired, each section is decoded
+   *              into data the first time it is requested.
+   */
+  typedef struct
+  {
+    unsigned char   content_bit_mask;  // Data contents of the frame
+    int             lost_frame_count;  // Number of frames dropped, as in SenselFrameData
+    SenselFrameData *data;             // FrameData the sections are decoded into
+    unsigned char   decoded_mask;      // Sections already decoded into data (FRAME_CONTENT_*_MASK)
+  } SenselFrameView;
+
+  /*!
+   * @discussion Cumulative link counters of a device handle, see senselGetStats
+   */
+  typedef struct
+  {
+    unsigned long long frames_received;      // Frames received with a valid checksum
+    unsigned long long bytes_received;       // Bytes read from the device, including register traffic
+    unsigned long long lost_frames;          // Frames the device dropped, from the rolling frame counter
+    unsigned int       checksum_errors;      // Frames discarded because of a checksum mismatch
+    unsigned int       protocol_errors;      // Unexpected acks, invalid frame headers and frames that failed to parse
+    unsigned int       timeouts;             // Reads that timed out waiting for the device
+    unsigned int       resyncs;              // Times the byte stream was realigned on a frame boundary
+    unsigned int       failed_reads;         // senselReadSensor calls that failed
+    unsigned int       peak_queue_depth;     // Largest number of frames buffered at once
+    unsigned int       buffer_reallocations; // Times the frame queue had to grow
+    unsigned int       capture_drops;        // Frames dropped because the capture queue was full, see senselStartCapture
+  } SenselStats;
+
+  /*!
+   * @param      handle    Sensel device handle the frame was read from
+   * @param      frame     Decoded frame, borrowed from the library and only valid during the call
+   * @param      user_data Pointer given to senselSetFrameCallback
+   * @discussion Called by senselReadSensor for every frame as soon as it has been received and decoded
+   */
+  typedef void (*SenselFrameCallback)(SENSEL_HANDLE handle, SenselFrameData *frame, void *user_data);
+
+  /*!
+   * @discussion Bounds and goals of the adaptive scan buffer controller, see senselSetAdaptiveBufferControl
+   */
+  typedef struct
+  {
+    unsigned char      min_buffers;          // Fewest scan buffers the controller may set
+    unsigned char      max_buffers;          // Most scan buffers the controller may set
+    unsigned short     min_frame_rate;       // Lowest frame rate the controller may set, must be at least 1
+    unsigned short     max_frame_rate;       // Highest frame rate the controller may set
+    unsigned int       target_latency_us;    // Scan to dequeue latency to stay under
+    float              max_loss;             // Highest acceptable fraction of frames lost by the device
+  } SenselAdaptiveBufferConfig;
+
+  /*!
+   * @discussion Decision taken by the adaptive scan buffer controller at the end of an observation window
+   */
+  typedef enum
+  {
+    ADAPTIVE_BUFFER_HOLD = 0,                // Settings left unchanged
+    ADAPTIVE_BUFFER_MORE_BUFFERS = 1,        // Buffers added because the device lost frames
+    ADAPTIVE_BUFFER_FEWER_BUFFERS = 2,       // Buffers removed because latency was over target
+    ADAPTIVE_BUFFER_LOWER_RATE = 3,          // Frame rate lowered because of losses or a consumer that falls behind
+    ADAPTIVE_BUFFER_RAISE_RATE = 4,          // Frame rate raised back while well within both goals
+  } SenselAdaptiveBufferAction;
+
+  /*!
+   * @discussion Measurements and decisions of the adaptive scan buffer controller, see senselGetAdaptiveBufferStats
+   */
+  typedef struct
+  {
+    unsigned char      buffers;              // Scan buffer count currently set
+    unsigned short     frame_rate;           // Frame rate currently set
+    unsigned int       latency_us;           // Mean scan to dequeue latency over the last window, or the age of the oldest queued frame if larger
+    float              loss;                 // Fraction of frames lost by the device over the last window
+    float              receive_rate;         // Frames per second received over the last window
+    float              dequeue_rate;         // Frames per second decoded by the application over the last window
+    unsigned int       queue_depth;          // Frames buffered at the end of the last window
+    unsigned int       adjustments;          // Number of changes made since the controller was enabled
+    SenselAdaptiveBufferAction last_action;  // Decision taken at the end of the last window
+  } SenselAdaptiveBufferStats;
+
   /*!
    * @discussion Sensel identifier information
    */
@@ -260,6 +478,17 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselOpenDeviceByComPort(SENSEL_HANDLE *handle, unsigned char *com_port);
 
+  /*!
+   * @param      handle  Sensel device handle to be initialized
+   * @param      type    Transport the device is reached through
+   * @param      address Address of the device on that transport (tty path, socket path or memory pipe name)
+   * @return     SENSEL_OK on success or error
+   * @discussion Opens a device over the given transport. Does not require senselGetDeviceList.
+   *              Only SENSEL_TRANSPORT_TTY is available on Windows.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselOpenDeviceByTransport(SENSEL_HANDLE *handle, SenselTransportType type, const char *address);
+
   /*!
    * @param      handle Sensel device to be closed
    * @return     SENSEL_OK on success or error
@@ -268,6 +497,16 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselClose(SENSEL_HANDLE handle);
 
+  /*!
+   * @param      handle    Sensel device handle
+   * @param      connected Pointer to retrieve 1 if the device is still connected, 0 otherwise
+   * @return     SENSEL_OK on success or error
+   * @discussion A device is reported disconnected once its link hangs up or a hotplug monitor saw it removed.
+   *              From then on reads and writes on the handle fail immediately. The handle must still be closed.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselIsDeviceConnected(SENSEL_HANDLE handle, unsigned char *connected);
+
   /*!
    * @param      handle Sensel device to reset
    * @return     SENSEL_OK on success or error
@@ -290,7 +529,8 @@ extern "C" {
    * @param      handle Sensel device handle for which to create a FrameData structure for
    * @param      data   Pointer to FrameData to allocate.
    * @return     SENSEL_OK on success or error
-   * @discussion Allocates a FrameData and initializes all buffers according to device capabilities.
+   * @discussion Allocates a FrameData and initializes all buffers according to device capabilities and
+   *              the contact format, see senselSetContactFormat.
    */
   SENSEL_API
   SenselStatus WINAPI senselAllocateFrameData(SENSEL_HANDLE handle, SenselFrameData **data);
@@ -375,6 +615,52 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselReadSensor(SENSEL_HANDLE handle);
 
+  /*!
+   * @param      handle     Sensel device handle
+   * @param      timeout_ms Maximum time to wait in milliseconds. -1 waits forever, 0 only reads what has already arrived.
+   * @return     SENSEL_OK once a frame is available, SENSEL_ERROR on timeout or error
+   * @discussion Reads from the sensor until at least one frame is available to senselGetFrame, or has been
+   *              passed to the frame callback. In SCAN_MODE_ASYNC the calling thread sleeps until data arrives.
+   *              In SCAN_MODE_SYNC each read requests a frame, so the wait can overrun timeout_ms by up to the
+   *              I/O timeout of one read.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselWaitForFrame(SENSEL_HANDLE handle, int timeout_ms);
+
+  /*!
+   * @param      handle     Sensel device handle
+   * @param      num_frames Number of frame requests to keep in flight ahead of the one being read, up to SENSEL_MAX_READ_AHEAD
+   * @return     SENSEL_OK on success or error
+   * @discussion Pipelines reads in SCAN_MODE_SYNC. As soon as the response to a frame request starts arriving, the next
+   *              requests are sent, so the device scans the following frames while the host reads and decodes this one.
+   *              Frames still come one response per request. Responses in flight are read and queued before any register
+   *              access. The default is 0, which sends each request from senselReadSensor.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselSetReadAhead(SENSEL_HANDLE handle, unsigned char num_frames);
+
+  /*!
+   * @param      handle     Sensel device handle
+   * @param      num_frames Pointer to retrieve the number of frame requests kept in flight
+   * @return     SENSEL_OK on success or error
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetReadAhead(SENSEL_HANDLE handle, unsigned char *num_frames);
+
+#ifndef WIN32
+  /*!
+   * @param      handle Sensel device handle
+   * @param      fd     Pointer to retrieve the file descriptor
+   * @return     SENSEL_OK on success, SENSEL_ERROR if the transport has no file descriptor (memory pipe)
+   * @discussion Gets a descriptor that becomes readable when the device has sent data, to watch from an external
+   *              event loop (poll, epoll, libuv, Qt). Meant for SCAN_MODE_ASYNC: call senselReadSensor whenever
+   *              it is readable. senselReadSensor consumes everything received, so edge triggered watches work too.
+   *              The descriptor belongs to the handle and must not be read from or closed. Not available on Windows.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetPollFd(SENSEL_HANDLE handle, int *fd);
+#endif //WIN32
+
   /*!
    * @param      handle           Sensel device handle
    * @param      num_avail_frames Will contain the number of frames available to GetFrame
@@ -393,6 +679,158 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselGetFrame(SENSEL_HANDLE handle, SenselFrameData *data);
 
+  /*!
+   * @param      handle Sensel device handle
+   * @param      data   Pointer to pre-allocated FrameData to populate
+   * @return     SENSEL_OK on success or error
+   * @discussion Returns the newest buffered frame in data and drops all older ones without decoding them.
+   *              Dropped frames are included in data->lost_frame_count.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetLatestFrame(SENSEL_HANDLE handle, SenselFrameData *data);
+
+  /*!
+   * @param      time_us Pointer to retrieve the host time in microseconds
+   * @return     SENSEL_OK on success or error
+   * @discussion Reads the monotonic host clock used for receive_time_us and dequeue_time_us of FrameData
+   *              (CLOCK_MONOTONIC on Linux and macOS, QueryPerformanceCounter on Windows).
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetHostTime(long long *time_us);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      stats  Pointer to retrieve the counters
+   * @return     SENSEL_OK on success or error
+   * @discussion Copies the link counters accumulated since the device was opened or since senselResetStats.
+   *              This only copies a few counters and is cheap enough to poll. Lost frames are counted as
+   *              frames are dequeued.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetStats(SENSEL_HANDLE handle, SenselStats *stats);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @return     SENSEL_OK on success or error
+   * @discussion Sets all link counters back to zero
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselResetStats(SENSEL_HANDLE handle);
+
+  /*!
+   * @param      handle    Sensel device handle
+   * @param      skew      Pointer to retrieve the host microseconds per unit of FrameData timestamp
+   * @param      offset_us Pointer to retrieve the host time at timestamp 0
+   * @return     SENSEL_OK on success or error if the model has not been fitted yet
+   * @discussion The library fits host_time = skew * timestamp + offset_us while scanning, using the least
+   *              delayed frame out of every 16 and the last 64 of those, and uses it to fill scan_time_us
+   *              of FrameData. Until it has been fitted, scan_time_us is the receive time. The model is reset
+   *              by senselStartScanning.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetClockModel(SENSEL_HANDLE handle, double *skew, double *offset_us);
+
+  /*!
+   * @param      handle     Sensel device handle
+   * @param      frames     Array of FrameData pointers, each allocated with senselAllocateFrameData
+   * @param      max_frames Number of entries in frames
+   * @param      num_frames Pointer to retrieve the number of frames decoded into frames
+   * @return     SENSEL_OK on success or error
+   * @discussion Decodes up to max_frames buffered frames, oldest first, in a single call. This replaces
+   *              calling senselGetNumAvailableFrames followed by one senselGetFrame per frame.
+   *              Returns SENSEL_OK with num_frames set to 0 if no frames are buffered.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetFrames(SENSEL_HANDLE handle, SenselFrameData **frames, unsigned int max_frames, unsigned int *num_frames);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      data   Pointer to pre-allocated FrameData that sections of the frame are decoded into
+   * @param      view   Pointer to the view to initialize
+   * @return     SENSEL_OK on success or error
+   * @discussion Parses the header of the oldest buffered frame and leaves its sections undecoded until
+   *              they are requested with senselFrameViewGetContacts, senselFrameViewGetAccel or
+   *              senselFrameViewGetForces. The frame stays buffered until senselReleaseFrameView;
+   *              only one view can be held at a time and the senselGetFrame family fails meanwhile.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselAcquireFrameView(SENSEL_HANDLE handle, SenselFrameData *data, SenselFrameView *view);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      view   View returned by senselAcquireFrameView
+   * @return     SENSEL_OK on success or error
+   * @discussion Decodes the contacts of the viewed frame into view->data, unless already decoded.
+   *              Fails if the frame has no contacts.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselFrameViewGetContacts(SENSEL_HANDLE handle, SenselFrameView *view);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      view   View returned by senselAcquireFrameView
+   * @return     SENSEL_OK on success or error
+   * @discussion Decodes the accelerometer data of the viewed frame into view->data, unless already decoded.
+   *              Fails if the frame has no accelerometer data.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselFrameViewGetAccel(SENSEL_HANDLE handle, SenselFrameView *view);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      view   View returned by senselAcquireFrameView
+   * @return     SENSEL_OK on success or error
+   * @discussion Decompresses the force and labels images of the viewed frame into view->data, unless already
+   *              decoded. Fails if the frame has neither, or if the library was built without SENSEL_PRESSURE.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselFrameViewGetForces(SENSEL_HANDLE handle, SenselFrameView *view);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      view   View returned by senselAcquireFrameView
+   * @return     SENSEL_OK on success or error
+   * @discussion Drops the viewed frame from the buffer. Sections already decoded into view->data stay valid.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReleaseFrameView(SENSEL_HANDLE handle, SenselFrameView *view);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      policy Dequeue policy used by senselGetFrame
+   * @return     SENSEL_OK on success or error
+   * @discussion With FRAME_QUEUE_LATEST, senselGetFrame behaves like senselGetLatestFrame and
+   *              senselGetNumAvailableFrames reports at most one frame. The default is FRAME_QUEUE_ALL.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselSetFrameQueuePolicy(SENSEL_HANDLE handle, SenselFrameQueuePolicy policy);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      policy Pointer to retrieve the dequeue policy
+   * @return     SENSEL_OK on success or error
+   * @discussion Gets the dequeue policy used by senselGetFrame
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetFrameQueuePolicy(SENSEL_HANDLE handle, SenselFrameQueuePolicy *policy);
+
+  /*!
+   * @param      handle         Sensel device handle
+   * @param      callback       Function called with every decoded frame, NULL to go back to senselGetFrame
+   * @param      user_data      Pointer passed back to callback
+   * @param      content_filter Frame content (FRAME_CONTENT_*_MASK) to decode and deliver, 0 for everything
+   * @return     SENSEL_OK on success or error
+   * @discussion While a callback is set, frames are handed to it in the reader's thread instead of being queued
+   *              for senselGetFrame, once the senselReadSensor call or register access that received them is over.
+   *              The callback may therefore use the register API, such as senselSetLEDBrightness. Only the sections
+   *              in content_filter are decoded and reported in the frame's content_bit_mask. Frames with none of
+   *              them stay queued, and while a callback is set they are the only ones senselGetFrame returns.
+   *              The callback must not call senselReadSensor or the senselGetFrame family.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselSetFrameCallback(SENSEL_HANDLE handle, SenselFrameCallback callback, void *user_data,
+                                             unsigned char content_filter);
+
   /*!
    * @param      handle   Sensel device handle
    * @param      num_leds Pointer to number of leds on device
@@ -562,6 +1000,31 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselGetMaxFrameRate(SENSEL_HANDLE handle, unsigned short *val);
 
+  /*!
+   * @param      handle Sensel device handle
+   * @param      config Bounds and goals of the controller, NULL to disable it
+   * @return     SENSEL_OK on success or error
+   * @discussion Lets the library tune the scan buffer count and the frame rate. senselReadSensor looks at the
+   *              latency, the device frame loss and the dequeue rate every half second and makes at most one change:
+   *              more buffers when frames are lost, fewer when latency is over target, and a lower frame rate when
+   *              buffers alone can't help or the application decodes slower than frames arrive. The frame rate is
+   *              raised back once latency is under half the target without losses, and lowered by at most a
+   *              quarter per window. A change is decided at the end of a read and written at the start of a
+   *              later one, once no frame request is in flight. Scan buffers are only used in SCAN_MODE_SYNC,
+   *              so in SCAN_MODE_ASYNC only the frame rate is tuned. Disabling the controller leaves the last
+   *              settings in place.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselSetAdaptiveBufferControl(SENSEL_HANDLE handle, const SenselAdaptiveBufferConfig *config);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      stats  Pointer to retrieve the measurements and decisions of the controller
+   * @return     SENSEL_OK on success, SENSEL_ERROR if the controller is disabled
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetAdaptiveBufferStats(SENSEL_HANDLE handle, SenselAdaptiveBufferStats *stats);
+
   /*!
    * @param      handle Sensel device handle
    * @param      mask   Contact information mask
@@ -582,6 +1045,29 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselGetContactsMask(SENSEL_HANDLE handle, unsigned char *mask);
 
+  /*!
+   * @param      handle Sensel device handle
+   * @param      format Format in which senselGetFrame returns contacts
+   * @return     SENSEL_OK on success or error
+   * @discussion With CONTACT_FORMAT_RAW, senselGetFrame fills data->contacts_raw with the fixed point values
+   *              sent by the device and data->unit_shift with their shifts, and leaves data->contacts untouched.
+   *              With CONTACT_FORMAT_ARRAYS, it fills data->contact_arrays instead, allocating the arrays
+   *              again whenever the contact mask changes. The default is CONTACT_FORMAT_FLOAT.
+   *              senselAllocateFrameData only allocates contacts_raw or contact_arrays for the format set at
+   *              the time. Frame data allocated before a change gets them with its first frame in the new format.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselSetContactFormat(SENSEL_HANDLE handle, SenselContactFormat format);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      format Pointer to retrieve the contact format
+   * @return     SENSEL_OK on success or error
+   * @discussion Gets the format in which senselGetFrame returns contacts
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetContactFormat(SENSEL_HANDLE handle, SenselContactFormat *format);
+
   /*!
    * @param      handle Sensel device handle
    * @param      reg    Register to read
@@ -630,6 +1116,292 @@ extern "C" {
   SENSEL_API
   SenselStatus WINAPI senselWriteRegVS(SENSEL_HANDLE handle, unsigned char reg, unsigned int size, unsigned char *buf, unsigned int *write_size);
 
+  /*!
+   * @param      handle          Sensel device handle
+   * @param      timeout_ms      Total time allowed for a register transaction or a senselReadSensor call.
+   *                              0 makes every read a non-blocking attempt: senselReadSensor only takes
+   *                              frames that have fully arrived and leaves a partly received one for the
+   *                              next call.
+   * @param      byte_timeout_ms Maximum time to wait for the next byte to arrive. 0 disables this limit.
+   * @return     SENSEL_OK on success or error
+   * @discussion Sets the serial I/O timeouts of the device. Both limits are measured against a monotonic clock,
+   *              and the total timeout covers the whole operation rather than each individual read.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselSetIOTimeout(SENSEL_HANDLE handle, unsigned int timeout_ms, unsigned int byte_timeout_ms);
+
+  /*!
+   * @param      handle          Sensel device handle
+   * @param      timeout_ms      Pointer to retrieve the total timeout
+   * @param      byte_timeout_ms Pointer to retrieve the inactivity timeout
+   * @return     SENSEL_OK on success or error
+   * @discussion Gets the serial I/O timeouts of the device.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetIOTimeout(SENSEL_HANDLE handle, unsigned int *timeout_ms, unsigned int *byte_timeout_ms);
+
+#ifndef WIN32
+  /*
+   * Memory pipe API (not available on Windows)
+   * A memory pipe is the device end of SENSEL_TRANSPORT_MEMORY_PIPE. Whatever is written to the pipe is
+   * received by the handle opened on it, and whatever the handle sends can be read back from the pipe.
+   * This lets a simulated device in the same process feed the full frame path without hardware.
+   */
+
+  /*!
+   * @discussion Handle to the device end of a memory pipe
+   */
+  typedef void *SENSEL_MEMORY_PIPE;
+
+  /*!
+   * @param      name Name passed as the address to senselOpenDeviceByTransport
+   * @param      pipe Memory pipe handle to be allocated
+   * @return     SENSEL_OK on success or error
+   * @discussion Creates a named memory pipe. Names must be unique and shorter than 64 characters.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselMemoryPipeCreate(const char *name, SENSEL_MEMORY_PIPE *pipe);
+
+  /*!
+   * @param      pipe Memory pipe to destroy
+   * @return     SENSEL_OK on success or error
+   * @discussion Destroys the device end of the pipe. A handle still open on it sees the device as disconnected.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselMemoryPipeDestroy(SENSEL_MEMORY_PIPE pipe);
+
+  /*!
+   * @param      pipe Memory pipe handle
+   * @param      buf  Bytes to send to the host end
+   * @param      len  Number of bytes in buf
+   * @return     SENSEL_OK on success or error
+   * @discussion Queues bytes for the handle opened on the pipe. Never blocks.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselMemoryPipeWrite(SENSEL_MEMORY_PIPE pipe, const unsigned char *buf, unsigned int len);
+
+  /*!
+   * @param      pipe       Memory pipe handle
+   * @param      buf        Buffer to receive the bytes sent by the host end
+   * @param      buf_size   Size of buf
+   * @param      read_size  Pointer to retrieve the number of bytes copied into buf
+   * @param      timeout_ms Maximum time to wait for data in milliseconds. -1 waits forever, 0 returns immediately.
+   * @return     SENSEL_OK on success or error
+   * @discussion Reads the bytes written by the handle opened on the pipe (register commands).
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselMemoryPipeRead(SENSEL_MEMORY_PIPE pipe, unsigned char *buf, unsigned int buf_size,
+                                           unsigned int *read_size, int timeout_ms);
+#endif //WIN32
+
+#ifdef __linux__
+  /*
+   * Reactor API (Linux only)
+   * A reactor services many devices from a single thread. It waits on all of their serial ports with epoll
+   * and reads frames from whichever device has data as soon as it arrives.
+   */
+
+  /*!
+   * @discussion Handle to a reactor
+   */
+  typedef void *SENSEL_REACTOR;
+
+  /*!
+   * @param      handle    Sensel device that was serviced
+   * @param      status    Result of reading the device. SENSEL_ERROR when the device was disconnected.
+   * @param      user_data Pointer given to senselReactorAddDevice
+   * @discussion Called from senselReactorPoll after frames have been read from a device.
+   *              Frames can be retrieved with senselGetNumAvailableFrames and senselGetFrame from within the callback.
+   */
+  typedef void (*SenselReactorCallback)(SENSEL_HANDLE handle, SenselStatus status, void *user_data);
+
+  /*!
+   * @param      reactor Reactor handle to be allocated
+   * @return     SENSEL_OK on success or error
+   * @discussion Creates a reactor with no devices
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorCreate(SENSEL_REACTOR *reactor);
+
+  /*!
+   * @param      reactor   Reactor handle
+   * @param      handle    Sensel device handle to service. The device must be in SCAN_MODE_ASYNC.
+   * @param      callback  Function called every time the device has been serviced, can be NULL
+   * @param      user_data Pointer passed back to callback
+   * @return     SENSEL_OK on success or error
+   * @discussion Adds a device to the reactor. Up to SENSEL_MAX_DEVICES devices can be added.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorAddDevice(SENSEL_REACTOR reactor, SENSEL_HANDLE handle,
+                                             SenselReactorCallback callback, void *user_data);
+
+  /*!
+   * @param      reactor Reactor handle
+   * @param      handle  Sensel device handle to remove
+   * @return     SENSEL_OK on success or error
+   * @discussion Stops servicing a device. Must be called before the device is closed.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorRemoveDevice(SENSEL_REACTOR reactor, SENSEL_HANDLE handle);
+
+  /*!
+   * @param      reactor    Reactor handle
+   * @param      timeout_ms Maximum time to wait for data in milliseconds. -1 waits forever, 0 returns immediately.
+   * @return     SENSEL_OK on success or error
+   * @discussion Waits until at least one device has data, then reads frames from every device that is ready.
+   *              Devices that hang up are removed from the reactor.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorPoll(SENSEL_REACTOR reactor, int timeout_ms);
+
+  /*!
+   * @param      reactor Reactor handle
+   * @return     SENSEL_OK on success or error
+   * @discussion Services devices until senselReactorStop is called
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorRun(SENSEL_REACTOR reactor);
+
+  /*!
+   * @param      reactor Reactor handle
+   * @return     SENSEL_OK on success or error
+   * @discussion Makes senselReactorRun return. Can be called from a callback or from another thread.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorStop(SENSEL_REACTOR reactor);
+
+  /*!
+   * @param      reactor Reactor handle to free
+   * @return     SENSEL_OK on success or error
+   * @discussion Frees the reactor. Devices that were added are not closed.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReactorDestroy(SENSEL_REACTOR reactor);
+
+  /*
+   * Capture API (Linux only)
+   * A capture thread owned by the library reads and decodes frames from one device and publishes them into
+   * a bounded queue of preallocated frames. Taking frames from the queue never blocks, locks or allocates.
+   * While capturing, the thread owns the handle: the capture calls below and senselGetStats are the only
+   * calls allowed on it until senselStopCapture. senselGetStats then reports the counters as of the last read.
+   */
+
+  /*!
+   * @param      handle    Sensel device handle. Scanning must have been started.
+   * @param      num_slots Number of frames the queue holds, rounded up to a power of two. 0 selects a default of 16.
+   *                       At most SENSEL_MAX_CAPTURE_SLOTS.
+   * @return     SENSEL_OK on success or error
+   * @discussion Starts the capture thread. The frames are allocated like senselAllocateFrameData, so the
+   *              frame content and contact format must be set beforehand. When the queue is full new frames
+   *              are dropped, counted in SenselStats.capture_drops and added to the lost_frame_count of the
+   *              next frame queued. The queue of a previous capture is freed, so none of its frames may still
+   *              be in use.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselStartCapture(SENSEL_HANDLE handle, unsigned int num_slots);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @return     SENSEL_OK on success or error
+   * @discussion Stops the capture thread. May be called from any thread, including while the consumer is
+   *              taking frames: the queue stays allocated, and frames already in it can still be acquired,
+   *              until senselClose or the next senselStartCapture. senselClose stops a running capture.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselStopCapture(SENSEL_HANDLE handle);
+
+  /*!
+   * @param      handle     Sensel device handle
+   * @param      num_frames Pointer to retrieve the number of frames waiting in the capture queue
+   * @return     SENSEL_OK on success or error
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselGetNumCapturedFrames(SENSEL_HANDLE handle, unsigned int *num_frames);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @param      frame  Pointer to retrieve the oldest frame in the capture queue
+   * @return     SENSEL_OK on success, SENSEL_ERROR if the queue is empty
+   * @discussion The frame stays owned by the queue and valid until senselReleaseCapturedFrame.
+   *              Only one thread may consume the queue.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselAcquireCapturedFrame(SENSEL_HANDLE handle, SenselFrameData **frame);
+
+  /*!
+   * @param      handle Sensel device handle
+   * @return     SENSEL_OK on success or error
+   * @discussion Hands the frame returned by senselAcquireCapturedFrame back to the capture thread
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselReleaseCapturedFrame(SENSEL_HANDLE handle);
+
+  /*
+   * Hotplug API (Linux only)
+   * A hotplug monitor watches /dev for serial ports coming and going and keeps the device list current.
+   * Handles open on a removed device are marked disconnected right away, and a call blocked waiting on one
+   * returns with an error. A reactor notices the removal once the serial port hangs up.
+   */
+
+  /*!
+   * @discussion Handle to a hotplug monitor
+   */
+  typedef void *SENSEL_HOTPLUG;
+
+  /*!
+   * @discussion Hotplug event reported to SenselHotplugCallback
+   */
+  typedef enum
+  {
+    SENSEL_HOTPLUG_ADDED   = 0,         // Device was plugged in
+    SENSEL_HOTPLUG_REMOVED = 1,         // Device was unplugged
+  } SenselHotplugEvent;
+
+  /*!
+   * @param      event     Whether the device was added or removed
+   * @param      device    Identity of the device. idx is its position in the current device list.
+   * @param      user_data Pointer given to senselHotplugCreate
+   * @discussion Called from senselHotplugProcess. A device can be opened from the callback with senselOpenDeviceByComPort.
+   */
+  typedef void (*SenselHotplugCallback)(SenselHotplugEvent event, const SenselDeviceID *device, void *user_data);
+
+  /*!
+   * @param      monitor   Hotplug monitor handle to be allocated
+   * @param      callback  Function called for every device added or removed, can be NULL
+   * @param      user_data Pointer passed back to callback
+   * @return     SENSEL_OK on success or error
+   * @discussion Creates a hotplug monitor. Devices already connected are not reported.
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselHotplugCreate(SENSEL_HOTPLUG *monitor, SenselHotplugCallback callback, void *user_data);
+
+  /*!
+   * @param      monitor Hotplug monitor handle
+   * @param      fd      Pointer to retrieve a file descriptor that becomes readable when senselHotplugProcess has work to do
+   * @return     SENSEL_OK on success or error
+   * @discussion Lets the monitor be driven from an existing poll, select or epoll loop
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselHotplugGetFd(SENSEL_HOTPLUG monitor, int *fd);
+
+  /*!
+   * @param      monitor    Hotplug monitor handle
+   * @param      timeout_ms Maximum time to wait for a change in milliseconds. -1 waits forever, 0 returns immediately.
+   * @return     SENSEL_OK on success or error
+   * @discussion Waits for nodes to be added to or removed from /dev, then updates the device list and calls the callback
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselHotplugProcess(SENSEL_HOTPLUG monitor, int timeout_ms);
+
+  /*!
+   * @param      monitor Hotplug monitor handle to free
+   * @return     SENSEL_OK on success or error
+   * @discussion Frees the hotplug monitor
+   */
+  SENSEL_API
+  SenselStatus WINAPI senselHotplugDestroy(SENSEL_HOTPLUG monitor);
+#endif //__linux__
+
 #ifdef __cplusplus
 }
 #endif
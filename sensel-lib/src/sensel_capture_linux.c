@@ -0,0 +1,307 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+
+
+// sensel_capture_linux.c: library owned thread reading a device into a lock-free frame queue
+
+#include "sensel.h"
+#include "sensel_device.h"
+#include "sensel_serial.h"
+#include "sensel_transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define SENSEL_CAPTURE_DEFAULT_SLOTS  16
+#define SENSEL_CAPTURE_WAIT_US        10000 // Longest the thread waits for data before checking for a stop request
+#define SENSEL_CACHE_LINE_SIZE        64
+
+extern unsigned char _senselResponseArrived(SenselDevice *device);
+
+// Single producer, single consumer ring of decoded frames. The capture thread is the only writer of
+// head and the consumer the only writer of tail, so each side needs nothing more than an acquire load
+// of the other's index and a release store of its own. The indices run freely and are masked on use.
+struct sensel_capture_s
+{
+  unsigned int    head __attribute__ ((aligned(SENSEL_CACHE_LINE_SIZE))); // Next slot the thread fills
+  unsigned int    tail __attribute__ ((aligned(SENSEL_CACHE_LINE_SIZE))); // Oldest slot held by the consumer
+  unsigned int    slot_mask __attribute__ ((aligned(SENSEL_CACHE_LINE_SIZE)));
+  SenselFrameData **slots;          // slot_mask + 1 preallocated frames
+  SenselFrameData *scratch;         // Receives the header of frames dropped while the ring is full
+  int             dropped_frames;   // Frames dropped since the last published frame, added to its lost_frame_count
+  SENSEL_HANDLE   handle;
+  pthread_t       thread;
+  int             stop;             // Set by the first senselStopCapture, which is the one to join the thread
+  int             stopped;          // Set once the thread has been joined and the handle is back with the application
+  pthread_mutex_t stats_lock;       // Guards stats
+  SenselStats     stats;            // Device counters as of the last read, for senselGetStats while capturing
+};
+
+// Copies the counters the thread updates, so that senselGetStats never reads them while they change
+static void _senselCaptureSnapshotStats(SenselCapture *capture, SenselDevice *device)
+{
+  pthread_mutex_lock(&capture->stats_lock);
+  capture->stats                = device->stats;
+  capture->stats.bytes_received = device->sensor_serial.rx_bytes;
+  capture->stats.timeouts       = device->sensor_serial.rx_timeouts;
+  pthread_mutex_unlock(&capture->stats_lock);
+}
+
+static void _senselCaptureFreeSlots(SenselCapture *capture)
+{
+  unsigned int i;
+
+  if(capture->slots)
+  {
+    for(i = 0; i <= capture->slot_mask; i++)
+    {
+      if(capture->slots[i])
+        senselFreeFrameData(capture->handle, capture->slots[i]);
+    }
+    free(capture->slots);
+  }
+  if(capture->scratch)
+    senselFreeFrameData(capture->handle, capture->scratch);
+}
+
+// Moves every frame the device has buffered into the ring
+static void _senselCapturePublish(SenselCapture *capture, SenselDevice *device)
+{
+  unsigned int num_frames;
+
+  while(senselGetNumAvailableFrames(capture->handle, &num_frames) == SENSEL_OK && num_frames > 0)
+  {
+    unsigned int    head = capture->head;
+    SenselFrameData *frame;
+
+    if(head - __atomic_load_n(&capture->tail, __ATOMIC_ACQUIRE) > capture->slot_mask)
+    {
+      SenselFrameView view;
+
+      // The consumer is behind. Drop the frame without decoding more than its header, and report it
+      // as lost on the next frame that makes it through.
+      if(senselAcquireFrameView(capture->handle, capture->scratch, &view) == SENSEL_OK)
+      {
+        capture->dropped_frames += view.lost_frame_count + 1;
+        senselReleaseFrameView(capture->handle, &view);
+      }
+      device->stats.capture_drops++;
+      continue;
+    }
+
+    frame = capture->slots[head & capture->slot_mask];
+    if(senselGetFrame(capture->handle, frame) != SENSEL_OK)
+      continue;
+
+    frame->lost_frame_count += capture->dropped_frames;
+    capture->dropped_frames = 0;
+
+    // Publish the frame contents before the new head
+    __atomic_store_n(&capture->head, head + 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void *_senselCaptureThread(void *arg)
+{
+  SenselCapture       *capture = (SenselCapture *)arg;
+  SenselDevice        *device  = (SenselDevice *)capture->handle;
+  SenselSerialHandle  *serial  = &device->sensor_serial;
+
+  while(!__atomic_load_n(&capture->stop, __ATOMIC_RELAXED) && !senselSerialIsDisconnected(serial))
+  {
+    // Asynchronous frames arrive on their own, so block until some do. Synchronous reads pace themselves.
+    if(device->scan_mode == SCAN_MODE_ASYNC && senselSerialGetAvailable(serial) <= 0)
+    {
+      if(serial->transport->wait(serial, false, SENSEL_CAPTURE_WAIT_US) < 0)
+        break;
+      continue;
+    }
+
+    // The start of a frame stays buffered until the rest arrives, so wait on the link for the rest
+    if(device->scan_mode == SCAN_MODE_ASYNC && serial->rx_count > 0 && !_senselResponseArrived(device))
+    {
+      if(senselSerialWaitForMore(serial, SENSEL_CAPTURE_WAIT_US / 1000) < 0)
+        break;
+      continue;
+    }
+
+    if(senselReadSensor(capture->handle) == SENSEL_OK)
+      _senselCapturePublish(capture, device);
+    _senselCaptureSnapshotStats(capture, device);
+  }
+
+  return NULL;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselStartCapture(SENSEL_HANDLE handle, unsigned int num_slots)
+{
+  SenselDevice  *device = (SenselDevice *)handle;
+  SenselCapture *capture;
+  unsigned int  size = 1;
+  unsigned int  i;
+
+  if(!device || !device->scanning_active || device->frame_view_active || num_slots > SENSEL_MAX_CAPTURE_SLOTS)
+    return SENSEL_ERROR;
+  if(device->capture && _senselCaptureIsRunning(device->capture))
+    return SENSEL_ERROR;
+
+  if(num_slots == 0)
+    num_slots = SENSEL_CAPTURE_DEFAULT_SLOTS;
+  while(size < num_slots)
+    size <<= 1;
+
+  // The queue of a stopped capture is kept for its consumer until now
+  if(device->capture)
+  {
+    _senselCaptureFree(device->capture);
+    device->capture = NULL;
+  }
+
+  capture = calloc(1, sizeof(SenselCapture));
+  if(!capture)
+    return SENSEL_ERROR;
+  pthread_mutex_init(&capture->stats_lock, NULL);
+
+  capture->handle    = handle;
+  capture->slot_mask = size - 1;
+  capture->slots     = calloc(size, sizeof(SenselFrameData *));
+  if(!capture->slots || senselAllocateFrameData(handle, &capture->scratch) != SENSEL_OK)
+    goto error;
+  for(i = 0; i < size; i++)
+  {
+    if(senselAllocateFrameData(handle, &capture->slots[i]) != SENSEL_OK)
+      goto error;
+  }
+
+  _senselCaptureSnapshotStats(capture, device);
+  device->capture = capture;
+  if(pthread_create(&capture->thread, NULL, _senselCaptureThread, capture) != 0)
+  {
+    printf("SENSEL ERROR: Unable to start the capture thread\n");
+    device->capture = NULL;
+    goto error;
+  }
+
+  return SENSEL_OK;
+
+error:
+  _senselCaptureFree(capture);
+  return SENSEL_ERROR;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselStopCapture(SENSEL_HANDLE handle)
+{
+  SenselDevice  *device = (SenselDevice *)handle;
+  SenselCapture *capture;
+
+  if(!device || !device->capture)
+    return SENSEL_ERROR;
+
+  // Only the caller that sets the flag joins the thread. The queue is left alone, its consumer may be
+  // running in another thread.
+  capture = device->capture;
+  if(__atomic_exchange_n(&capture->stop, true, __ATOMIC_RELAXED))
+    return SENSEL_ERROR;
+  pthread_join(capture->thread, NULL);
+
+  __atomic_store_n(&capture->stopped, true, __ATOMIC_RELEASE);
+  return SENSEL_OK;
+}
+
+unsigned char _senselCaptureIsRunning(SenselCapture *capture)
+{
+  return !__atomic_load_n(&capture->stopped, __ATOMIC_ACQUIRE);
+}
+
+void _senselCaptureGetStats(SenselCapture *capture, SenselStats *stats)
+{
+  pthread_mutex_lock(&capture->stats_lock);
+  *stats = capture->stats;
+  pthread_mutex_unlock(&capture->stats_lock);
+}
+
+// Frees the queue of a capture whose thread was never started or has been joined
+void _senselCaptureFree(SenselCapture *capture)
+{
+  _senselCaptureFreeSlots(capture);
+  pthread_mutex_destroy(&capture->stats_lock);
+  free(capture);
+}
+
+SENSEL_API
+SenselStatus WINAPI senselAcquireCapturedFrame(SENSEL_HANDLE handle, SenselFrameData **frame)
+{
+  SenselDevice  *device = (SenselDevice *)handle;
+  SenselCapture *capture;
+  unsigned int  tail;
+
+  if(!device || !device->capture || !frame)
+    return SENSEL_ERROR;
+
+  capture = device->capture;
+  tail    = capture->tail;
+  if(__atomic_load_n(&capture->head, __ATOMIC_ACQUIRE) == tail)
+    return SENSEL_ERROR;
+
+  *frame = capture->slots[tail & capture->slot_mask];
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReleaseCapturedFrame(SENSEL_HANDLE handle)
+{
+  SenselDevice  *device = (SenselDevice *)handle;
+  SenselCapture *capture;
+  unsigned int  tail;
+
+  if(!device || !device->capture)
+    return SENSEL_ERROR;
+
+  capture = device->capture;
+  tail    = capture->tail;
+  if(__atomic_load_n(&capture->head, __ATOMIC_ACQUIRE) == tail)
+    return SENSEL_ERROR;
+
+  // The slot is handed back to the thread only after the consumer is done reading it
+  __atomic_store_n(&capture->tail, tail + 1, __ATOMIC_RELEASE);
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselGetNumCapturedFrames(SENSEL_HANDLE handle, unsigned int *num_frames)
+{
+  SenselDevice  *device = (SenselDevice *)handle;
+  SenselCapture *capture;
+
+  if(!device || !device->capture || !num_frames)
+    return SENSEL_ERROR;
+
+  capture     = device->capture;
+  *num_frames = __atomic_load_n(&capture->head, __ATOMIC_ACQUIRE) - capture->tail;
+  return SENSEL_OK;
+}
@@ -34,12 +34,18 @@
 #define SENSEL_MAGIC_LEN               6
 #define SENSEL_NULL_LABEL              255
 
+#define SENSEL_FRAME_HEADER_SIZE       6
 #define CONTACT_DEFAULT_SEND_SIZE      10
 #define CONTACT_ELLIPSE_SEND_SIZE      6
 #define CONTACT_DELTAS_SEND_SIZE       8
 #define CONTACT_BOUNDING_BOX_SEND_SIZE 8
 #define CONTACT_PEAK_SEND_SIZE         6
 
+#define SENSEL_CLOCK_SYNC_BUCKET_FRAMES 16
+#define SENSEL_CLOCK_SYNC_WINDOW        64
+
+#define SENSEL_ADAPTIVE_BUFFER_WINDOW_US 500000 // Observation window of the adaptive buffer controller
+
 typedef void *SENSEL_DECOMP_HANDLE;
 
 #ifdef __cplusplus
@@ -49,12 +55,97 @@ extern "C" {
 	typedef struct
 	{
 		#if WIN32
-      void*  serial_handle;
+      void*          serial_handle;
+      unsigned int   timeout_ms;                          // Total time allowed for one transaction
+      unsigned int   byte_timeout_ms;                     // Maximum time to wait for the next byte
+      volatile unsigned char disconnected;                // Set once the device is known to be gone
+      long long      rx_time_us;                          // Host time of the last read that returned data
+      unsigned long long rx_bytes;                        // Bytes received since open or the last stats reset
+      unsigned int   rx_timeouts;                         // Reads that timed out since open or the last stats reset
 		#else
-      int    serial_fd;
+      const struct sensel_transport_s *transport;         // Backend carrying the byte stream
+      void           *transport_ctx;                      // Backend private state
+      int            serial_fd;                           // Descriptor of fd based transports, -1 otherwise
+      unsigned char  *rx_buffer;                          // Read-ahead receive ring
+      unsigned int   rx_capacity;                         // Size of the receive ring (power of two)
+      unsigned int   rx_head;                             // Index of the first unread byte in the ring
+      unsigned int   rx_count;                            // Number of unread bytes in the ring
+      unsigned int   timeout_ms;                          // Total time allowed for one transaction
+      unsigned int   byte_timeout_ms;                     // Maximum time to wait for the next byte
+      long long      deadline_us;                         // Monotonic time at which the current transaction expires
+      char           address[128];                        // Resolved address the handle was opened on
+      unsigned char  disconnected;                        // Set once the device is known to be gone, see senselSerialIsDisconnected
+      int            wake_fd;                             // eventfd that wakes a blocked wait when the handle is marked disconnected, -1 if none
+      long long      rx_time_us;                          // Host time of the last read that returned data
+      unsigned long long rx_bytes;                        // Bytes received since open or the last stats reset
+      unsigned int   rx_timeouts;                         // Reads that timed out since open or the last stats reset
 		#endif
 	} SenselSerialHandle;
 
+  // One (device time, host receive time) pair of the clock model, relative to the model origin
+  typedef struct
+  {
+    double                      device_time;
+    double                      host_time;
+  } SenselClockSample;
+
+  // Online estimate of host_time = skew * device_time + offset. Each bucket of frames contributes the
+  // sample that arrived with the least delay, and the model is a least squares fit over the last buckets.
+  typedef struct
+  {
+    SenselClockSample           samples[SENSEL_CLOCK_SYNC_WINDOW]; // Ring of bucket minima
+    int                         num_samples;
+    int                         next_sample;
+    SenselClockSample           bucket_min;               // Least delayed sample of the current bucket
+    int                         bucket_frames;            // Frames seen in the current bucket
+    double                      origin_device_time;       // Device time of the first sample
+    long long                   origin_host_time_us;      // Host time of the first sample
+    unsigned char               has_origin;
+    double                      skew;                     // Host microseconds per device time unit
+    double                      offset;                   // Host time at device time 0, relative to the origin
+    unsigned char               valid;                    // Set once skew and offset have been fitted
+  } SenselClockSync;
+
+  // Adaptive scan buffer controller. Frames decoded during a window are accumulated here, and the
+  // decision is taken by senselReadSensor once the window is over. The change it decides on is only
+  // written to the device before a later read, once no frame request is in flight.
+  typedef struct
+  {
+    unsigned char               enabled;
+    SenselAdaptiveBufferConfig  config;
+    SenselAdaptiveBufferStats   stats;                    // Current settings and the last decision
+    long long                   window_start_us;          // Host time at which the current window started
+    unsigned long long          window_received;          // stats.frames_received at the window start
+    unsigned long long          window_lost;              // stats.lost_frames at the window start
+    unsigned int                window_dequeued;          // Frames decoded during the window
+    long long                   window_latency_us;        // Sum of their scan to dequeue latencies
+    unsigned char               pending;                  // A change has been decided but not written yet
+    unsigned char               pending_buffers;          // Scan buffer count to write
+    unsigned short              pending_frame_rate;       // Frame rate to write
+  } SenselAdaptiveBuffer;
+
+  // Location of a buffered frame in the frame buffer
+  typedef struct
+  {
+    int                         offset;                   // Offset of the frame payload
+    int                         size;                     // Payload size, not counting the checksum that follows it
+    long long                   receive_time_us;          // Host time at which the last byte of the frame was read
+    unsigned char               header_parsed;            // The fields below are set, see _senselParseSlotHeader
+    int                         elapsed_frames;           // Frames the device produced since the previous frame
+    unsigned long long          timestamp;                // Device timestamp, extended past 32 bit wraps
+    long long                   scan_time_us;             // Host time at which the frame was scanned
+  } SenselFrameSlot;
+
+  // Capture thread state, defined by the platform that implements senselStartCapture
+  typedef struct sensel_capture_s SenselCapture;
+
+#ifdef __linux__
+  // Used by sensel.c on a handle with a capture, see sensel_capture_linux.c
+  unsigned char _senselCaptureIsRunning(SenselCapture *capture);
+  void          _senselCaptureGetStats(SenselCapture *capture, SenselStats *stats);
+  void          _senselCaptureFree(SenselCapture *capture);
+#endif //__linux__
+
   typedef struct sensel_device_s
   {
     SenselSerialHandle          sensor_serial;            // Handle to the serial interface
@@ -63,25 +154,54 @@ extern "C" {
     SENSEL_DECOMP_HANDLE        decomp_handle;            // Decompression handle
 
     unsigned char               supported_frame_content;  // Content the device supports
-    // Temporary buffers for force frame decompression
+    // Queue of received frames. Payloads are written once, back to back in frame_buffer, wrapping
+    // to the start when the oldest frames have been consumed, and indexed in arrival order by frame_slots.
     unsigned char               *frame_buffer;
     int                         frame_buffer_capacity;
-    int                         frame_buffer_size;
+    SenselFrameSlot             *frame_slots;             // Ring of num_buffered_frames slots
+    int                         frame_slots_capacity;
+    int                         frame_slots_head;         // Slot of the oldest buffered frame
 
     // Conversion factors
     float                       dims_value_scale;         // Dimension value scale
     float                       force_value_scale;        // Force value scale
     float                       angle_value_scale;        // Angle value scale
     float                       area_value_scale;         // Area value scale
+    float                       dims_value_inv;           // Reciprocals of the scales above, used when decoding
+    float                       force_value_inv;
+    float                       angle_value_inv;
+    float                       area_value_inv;
+    SenselUnitShift             unit_shift;               // Shifts the scales above are derived from
+    SenselContactFormat         contact_format;           // Format senselGetFrame uses for contacts
 
     // Variables to keep track of sensel scan state
     unsigned char               frame_content_control;		// Curent frame content control
+    unsigned char               frame_content_bound;      // Content frames may carry: the current one and, until scanning restarts, earlier ones
     unsigned char               scan_buffer_control;      // Number of scan buffers currently enabled
     SenselScanMode              scan_mode;                // Current scan mode setting
+    unsigned char               read_ahead;               // Frame requests sent ahead in sync mode, see senselSetReadAhead
+    unsigned char               reads_in_flight;          // Frame requests sent whose response hasn't started arriving
+    long long                   request_time_us;          // When the oldest frame request in flight was sent
     unsigned char               scanning_active;          // Is scanning enabled / disabled
     int                         num_buffered_frames;      // Number of frames currently buffered
+    SenselFrameQueuePolicy      frame_queue_policy;       // How senselGetFrame dequeues buffered frames
+    int                         skipped_frame_count;      // Frames dropped undecoded since the last decoded frame
+    unsigned char               frame_view_active;        // The frame at frame_view_index is held by a SenselFrameView
+    int                         frame_view_index;         // Position in the queue of the viewed frame
     unsigned char               prev_rolling_frame_counter;
     unsigned int                prev_timestamp;           // Timestamp of the previous frame
+    unsigned int                timestamp_wraps;          // Number of times the 32 bit timestamp wrapped
+    unsigned char               time_shift;               // SENSEL_REG_UNIT_SHIFT_TIME
+    double                      time_value_inv;           // Reciprocal of the timestamp scale
+    SenselClockSync             clock_sync;               // Device to host clock model
+    SenselAdaptiveBuffer        adaptive_buffer;          // See senselSetAdaptiveBufferControl
+    SenselStats                 stats;                    // Link counters, bytes and timeouts are kept by sensor_serial
+    SenselCapture               *capture;                 // Queue of the last capture, its thread owns the handle while running
+    SenselFrameCallback         frame_callback;           // Receives frames as they are read, see senselSetFrameCallback
+    void                        *frame_callback_user_data;
+    unsigned char               frame_callback_filter;    // Content decoded for frame_callback
+    SenselFrameData             *frame_callback_frame;    // Frame lent to frame_callback
+    int                         frame_callback_kept;      // Oldest frames passed over by frame_callback_filter
 
     unsigned char               dynamic_baseline_enabled; // Is dynamic baselining enabled
 
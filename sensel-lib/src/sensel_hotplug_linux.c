@@ -0,0 +1,212 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+
+// sensel_hotplug_linux.c: inotify based monitor keeping the device list current
+
+#include "sensel.h"
+#include "sensel_device.h"
+#include "sensel_serial.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+#define SENSEL_HOTPLUG_WATCH_DIR "/dev"
+
+typedef struct
+{
+  int                   inotify_fd;   // Watches SENSEL_HOTPLUG_WATCH_DIR for nodes coming and going
+  SenselHotplugCallback callback;     // Called for every device added or removed
+  void                  *user_data;   // Passed back to callback
+  SenselDeviceList      devices;      // Devices present after the last rescan
+} SenselHotplug;
+
+static unsigned char _senselHotplugContains(const SenselDeviceList *list, const SenselDeviceID *devid)
+{
+  int i;
+
+  for(i = 0; i < list->num_devices; i++)
+  {
+    if(strcmp((const char *)list->devices[i].com_port, (const char *)devid->com_port) == 0 &&
+       strcmp((const char *)list->devices[i].serial_num, (const char *)devid->serial_num) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Rescans and reports the difference with the previous list. The scan only reads sysfs
+// attributes of new ttys, and returns the cached list when the tty set didn't change.
+static void _senselHotplugRescan(SenselHotplug *monitor)
+{
+  SenselDeviceList  list;
+  int               i;
+
+  memset(&list, 0, sizeof(SenselDeviceList));
+  senselSerialScan(&list);
+
+  for(i = 0; i < monitor->devices.num_devices; i++)
+  {
+    SenselDeviceID *devid = &monitor->devices.devices[i];
+
+    if(_senselHotplugContains(&list, devid))
+      continue;
+
+    // Fail handles on the removed device now rather than when their next read times out
+    senselSerialMarkDisconnected((const char *)devid->com_port);
+    if(monitor->callback)
+      monitor->callback(SENSEL_HOTPLUG_REMOVED, devid, monitor->user_data);
+  }
+
+  for(i = 0; i < list.num_devices; i++)
+  {
+    if(!_senselHotplugContains(&monitor->devices, &list.devices[i]) && monitor->callback)
+      monitor->callback(SENSEL_HOTPLUG_ADDED, &list.devices[i], monitor->user_data);
+  }
+
+  monitor->devices = list;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselHotplugCreate(SENSEL_HOTPLUG *monitor, SenselHotplugCallback callback, void *user_data)
+{
+  SenselHotplug *m;
+
+  if(!monitor)
+    return SENSEL_ERROR;
+
+  *monitor = NULL;
+
+  m = calloc(1, sizeof(SenselHotplug));
+  if(!m)
+    return SENSEL_ERROR;
+
+  m->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(m->inotify_fd == -1)
+  {
+    perror("inotify_init1");
+    free(m);
+    return SENSEL_ERROR;
+  }
+
+  if(inotify_add_watch(m->inotify_fd, SENSEL_HOTPLUG_WATCH_DIR, IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) == -1)
+  {
+    perror("inotify_add_watch");
+    close(m->inotify_fd);
+    free(m);
+    return SENSEL_ERROR;
+  }
+
+  m->callback  = callback;
+  m->user_data = user_data;
+
+  // Devices already present are the baseline, they are not reported as added
+  senselSerialScan(&m->devices);
+
+  *monitor = m;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselHotplugGetFd(SENSEL_HOTPLUG monitor, int *fd)
+{
+  SenselHotplug *m = (SenselHotplug *)monitor;
+
+  if(!m || !fd)
+    return SENSEL_ERROR;
+
+  *fd = m->inotify_fd;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselHotplugProcess(SENSEL_HOTPLUG monitor, int timeout_ms)
+{
+  SenselHotplug   *m = (SenselHotplug *)monitor;
+  struct pollfd   pfd;
+  char            events[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  unsigned char   changed = false;
+  ssize_t         len;
+  int             ret;
+
+  if(!m)
+    return SENSEL_ERROR;
+
+  pfd.fd      = m->inotify_fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+
+  ret = poll(&pfd, 1, timeout_ms);
+  if(ret == -1)
+  {
+    if(errno == EINTR)
+      return SENSEL_OK;
+    perror("poll");
+    return SENSEL_ERROR;
+  }
+  if(ret == 0)
+    return SENSEL_OK;
+
+  // Drain every pending event, one rescan covers a whole burst
+  while((len = read(m->inotify_fd, events, sizeof(events))) > 0)
+  {
+    char *ptr;
+
+    for(ptr = events; ptr < events + len; )
+    {
+      const struct inotify_event *event = (const struct inotify_event *)ptr;
+
+      if(event->len > 0 || (event->mask & IN_Q_OVERFLOW))
+        changed = true;
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  if(len == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+  {
+    perror("read inotify");
+    return SENSEL_ERROR;
+  }
+
+  if(changed)
+    _senselHotplugRescan(m);
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselHotplugDestroy(SENSEL_HOTPLUG monitor)
+{
+  SenselHotplug *m = (SenselHotplug *)monitor;
+
+  if(!m)
+    return SENSEL_ERROR;
+
+  close(m->inotify_fd);
+  free(m);
+  return SENSEL_OK;
+}
@@ -0,0 +1,307 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// sensel_reactor_linux.c: epoll based reactor servicing many Sensel devices from one thread
+
+#include "sensel.h"
+#include "sensel_device.h"
+#include "sensel_serial.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define SENSEL_REACTOR_MAX_EVENTS SENSEL_MAX_DEVICES
+
+typedef struct
+{
+  SENSEL_HANDLE         handle;     // Device serviced by this entry, NULL if the entry is free
+  SenselReactorCallback callback;   // Called after frames have been read from the device
+  void                  *user_data; // Passed back to callback
+} SenselReactorEntry;
+
+typedef struct
+{
+  int                 epoll_fd;                       // epoll instance watching all device fds
+  int                 wakeup_fd;                      // eventfd used to interrupt senselReactorRun
+  volatile int        running;                        // Cleared by senselReactorStop
+  SenselReactorEntry  entries[SENSEL_MAX_DEVICES];    // Registered devices
+} SenselReactor;
+
+static SenselReactorEntry *_senselReactorFindEntry(SenselReactor *reactor, SENSEL_HANDLE handle)
+{
+  int i;
+
+  for(i = 0; i < SENSEL_MAX_DEVICES; i++)
+  {
+    if(reactor->entries[i].handle == handle)
+      return &reactor->entries[i];
+  }
+  return NULL;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorCreate(SENSEL_REACTOR *reactor)
+{
+  SenselReactor       *r;
+  struct epoll_event  ev;
+
+  if(!reactor)
+    return SENSEL_ERROR;
+
+  *reactor = NULL;
+
+  r = calloc(1, sizeof(SenselReactor));
+  if(!r)
+    return SENSEL_ERROR;
+
+  r->wakeup_fd = -1;
+  r->epoll_fd  = epoll_create1(EPOLL_CLOEXEC);
+  if(r->epoll_fd == -1)
+  {
+    perror("epoll_create1");
+    goto error;
+  }
+
+  r->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(r->wakeup_fd == -1)
+  {
+    perror("eventfd");
+    goto error;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events   = EPOLLIN;
+  ev.data.ptr = NULL; // The wakeup fd is the only registration without an entry
+  if(epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, r->wakeup_fd, &ev) == -1)
+  {
+    perror("epoll_ctl");
+    goto error;
+  }
+
+  *reactor = r;
+  return SENSEL_OK;
+
+error:
+  if(r->wakeup_fd != -1)
+    close(r->wakeup_fd);
+  if(r->epoll_fd != -1)
+    close(r->epoll_fd);
+  free(r);
+  return SENSEL_ERROR;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorAddDevice(SENSEL_REACTOR reactor, SENSEL_HANDLE handle,
+                                           SenselReactorCallback callback, void *user_data)
+{
+  SenselReactor       *r      = (SenselReactor *)reactor;
+  SenselDevice        *device = (SenselDevice *)handle;
+  SenselReactorEntry  *entry;
+  struct epoll_event  ev;
+
+  if(!r || !device)
+    return SENSEL_ERROR;
+
+  if(device->scan_mode != SCAN_MODE_ASYNC)
+  {
+    printf("senselReactorAddDevice. Device must be in SCAN_MODE_ASYNC\n");
+    return SENSEL_ERROR;
+  }
+
+  if(device->sensor_serial.serial_fd == -1)
+  {
+    printf("senselReactorAddDevice. Device transport has no file descriptor\n");
+    return SENSEL_ERROR;
+  }
+
+  if(_senselReactorFindEntry(r, handle))
+    return SENSEL_ERROR;
+
+  entry = _senselReactorFindEntry(r, NULL);
+  if(!entry)
+    return SENSEL_ERROR;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events   = EPOLLIN;
+  ev.data.ptr = entry;
+  if(epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, device->sensor_serial.serial_fd, &ev) == -1)
+  {
+    perror("epoll_ctl");
+    return SENSEL_ERROR;
+  }
+
+  entry->handle     = handle;
+  entry->callback   = callback;
+  entry->user_data  = user_data;
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorRemoveDevice(SENSEL_REACTOR reactor, SENSEL_HANDLE handle)
+{
+  SenselReactor       *r      = (SenselReactor *)reactor;
+  SenselDevice        *device = (SenselDevice *)handle;
+  SenselReactorEntry  *entry;
+
+  if(!r || !device)
+    return SENSEL_ERROR;
+
+  entry = _senselReactorFindEntry(r, handle);
+  if(!entry)
+    return SENSEL_ERROR;
+
+  // The fd may already be gone if the device was unplugged, so ignore errors here
+  epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, device->sensor_serial.serial_fd, NULL);
+  memset(entry, 0, sizeof(SenselReactorEntry));
+
+  return SENSEL_OK;
+}
+
+static void _senselReactorServiceEntry(SenselReactor *r, SenselReactorEntry *entry, unsigned int events)
+{
+  SENSEL_HANDLE         handle    = entry->handle;
+  SenselReactorCallback callback  = entry->callback;
+  void                  *user_data = entry->user_data;
+  SenselStatus          status;
+
+  if(events & (EPOLLHUP | EPOLLERR))
+  {
+    // The device went away. Stop watching it so the reactor doesn't spin on the hangup.
+    senselSerialSetDisconnected(&((SenselDevice *)handle)->sensor_serial);
+    senselReactorRemoveDevice(r, handle);
+    if(callback)
+      callback(handle, SENSEL_ERROR, user_data);
+    return;
+  }
+
+  // In async mode, senselReadSensor takes every complete frame that has arrived. A partial one is left in
+  // the input, and the rest of it wakes the reactor again.
+  status = senselReadSensor(handle);
+
+  if(callback)
+    callback(handle, status, user_data);
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorPoll(SENSEL_REACTOR reactor, int timeout_ms)
+{
+  SenselReactor       *r = (SenselReactor *)reactor;
+  struct epoll_event  events[SENSEL_REACTOR_MAX_EVENTS + 1];
+  int                 num_events;
+  int                 i;
+
+  if(!r)
+    return SENSEL_ERROR;
+
+  num_events = epoll_wait(r->epoll_fd, events, SENSEL_REACTOR_MAX_EVENTS + 1, timeout_ms);
+  if(num_events == -1)
+  {
+    if(errno == EINTR)
+      return SENSEL_OK;
+    perror("epoll_wait");
+    return SENSEL_ERROR;
+  }
+
+  for(i = 0; i < num_events; i++)
+  {
+    SenselReactorEntry *entry = (SenselReactorEntry *)events[i].data.ptr;
+
+    if(entry == NULL)
+    {
+      uint64_t val;
+      if(read(r->wakeup_fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        perror("read wakeup fd");
+      continue;
+    }
+
+    // The entry may have been removed by a callback earlier in this batch
+    if(entry->handle == NULL)
+      continue;
+
+    _senselReactorServiceEntry(r, entry, events[i].events);
+  }
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorRun(SENSEL_REACTOR reactor)
+{
+  SenselReactor *r = (SenselReactor *)reactor;
+
+  if(!r)
+    return SENSEL_ERROR;
+
+  r->running = true;
+  while(r->running)
+  {
+    if(senselReactorPoll(reactor, -1) != SENSEL_OK)
+    {
+      r->running = false;
+      return SENSEL_ERROR;
+    }
+  }
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorStop(SENSEL_REACTOR reactor)
+{
+  SenselReactor *r   = (SenselReactor *)reactor;
+  uint64_t      val  = 1;
+
+  if(!r)
+    return SENSEL_ERROR;
+
+  r->running = false;
+  if(write(r->wakeup_fd, &val, sizeof(val)) < 0)
+  {
+    perror("write wakeup fd");
+    return SENSEL_ERROR;
+  }
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselReactorDestroy(SENSEL_REACTOR reactor)
+{
+  SenselReactor *r = (SenselReactor *)reactor;
+
+  if(!r)
+    return SENSEL_ERROR;
+
+  close(r->wakeup_fd);
+  close(r->epoll_fd);
+  free(r);
+
+  return SENSEL_OK;
+}
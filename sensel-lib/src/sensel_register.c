@@ -29,13 +29,42 @@
 #include "sensel_serial.h"
 
 extern unsigned char _senselReadFrame(SenselDevice *device);
+extern void          _senselDrainFrameRequests(SenselDevice *device);
+extern void          _senselDispatchFrames(SenselDevice *device);
 
-sensel_protocol_cmd_t    read_cmd     = {(DEFAULT_BOARD_ADDR | (1 << 7)), 0x00, 0x00, 0x00};
-sensel_protocol_cmd_t    write_cmd    = { DEFAULT_BOARD_ADDR, 0x00, 0x00, 0x00};
-sensel_protocol_cmd_vs_t write_cmd_vs = { DEFAULT_BOARD_ADDR, 0x00, 0x00, 0, 0x00, 0x00};
+// Each transaction runs to completion before frames read along the way, async frames interleaved with
+// the answer or responses drained ahead of it, reach the frame callback. A callback may then use the
+// register API itself.
+static SenselStatus _senselEndTransaction(SENSEL_HANDLE handle, SenselStatus status)
+{
+  if(handle)
+    _senselDispatchFrames((SenselDevice *)handle);
+  return status;
+}
 
-SenselStatus _senselReadReg(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
-                            unsigned char size, unsigned char *buf)
+// Reads the first byte of a response. In async mode, frames the device streams ahead of it are read
+// and queued along the way.
+static unsigned char _senselReadAck(SenselDevice *device, SenselSerialHandle *serial, unsigned char *ack)
+{
+  if(!senselSerialReadBytes(serial, ack, 1))
+    return false;
+
+  while(device && device->scan_mode == SCAN_MODE_ASYNC && *ack == PT_ASYNC_DATA)
+  {
+    if(!_senselReadFrame(device))
+    {
+      printf("SENSEL ERROR: Error reading async frame.\n");
+    }
+
+    // Get the new ack
+    if(!senselSerialReadBytes(serial, ack, 1))
+      return false;
+  }
+  return true;
+}
+
+static SenselStatus _senselReadRegTransaction(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                                              unsigned char size, unsigned char *buf)
 {
   SenselDevice    *device   = (SenselDevice *)handle;
   unsigned char   ack;
@@ -44,29 +73,20 @@ SenselStatus _senselReadReg(SENSEL_HANDLE handle, SenselSerialHandle *serial, un
   unsigned char   checksum  = 0;
   int             i;
 
-  read_cmd.reg = reg;
-  read_cmd.size = size;
+  // Commands are built on the stack so that independent handles can be used from different threads
+  sensel_protocol_cmd_t cmd = {SENSEL_READ_ADDR, reg, size, 0x00};
 
-  if(!senselSerialWrite(serial, (unsigned char *)&read_cmd, 3))
-    return SENSEL_ERROR;
+  // Pipelined frame responses would otherwise be taken for the answer
+  if(device && device->reads_in_flight > 0)
+    _senselDrainFrameRequests(device);
 
-  if(!senselSerialReadBytes(serial, (unsigned char *)&ack, 1))
+  senselSerialStartTimeout(serial);
+
+  if(!senselSerialWrite(serial, (unsigned char *)&cmd, 3))
     return SENSEL_ERROR;
 
-  if (device)
-  {
-    while(device->scan_mode == SCAN_MODE_ASYNC && ack == PT_ASYNC_DATA)
-    {
-      if(!_senselReadFrame(device))
-      {
-        printf("SENSEL ERROR: Error reading async frame.\n");
-      }
-
-      // Get the new ack
-      if(!senselSerialReadBytes(serial, (unsigned char *)&ack, 1))
-        return SENSEL_ERROR;
-    }
-  }
+  if(!_senselReadAck(device, serial, &ack))
+    return SENSEL_ERROR;
 
   if(ack != PT_READ_ACK)
   {
@@ -99,75 +119,68 @@ SenselStatus _senselReadReg(SENSEL_HANDLE handle, SenselSerialHandle *serial, un
   return SENSEL_OK;
 }
 
-SenselStatus _senselWriteReg(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
-                             unsigned char size, unsigned char *buf)
+static SenselStatus _senselWriteRegTransaction(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                                               unsigned char size, unsigned char *buf)
 {
   SenselDevice  *device   = (SenselDevice *)handle;
   unsigned char ack;
   unsigned char checksum  = 0;
   int           i;
 
-  write_cmd.reg = reg;
-  write_cmd.size = size;
+  sensel_protocol_cmd_t cmd = {SENSEL_WRITE_ADDR, reg, size, 0x00};
 
   for(i = 0; i < size; i++)
     checksum += buf[i];
 
-  //Send write header
-  if(!senselSerialWrite(serial, (unsigned char *)&write_cmd, 3))
-    return SENSEL_ERROR;
+  if(device && device->reads_in_flight > 0)
+    _senselDrainFrameRequests(device);
 
-  //Send data
-  if(!senselSerialWrite(serial, buf, size))
-    return SENSEL_ERROR;
+  senselSerialStartTimeout(serial);
+
+  //Send write header, data and checksum in one write
+  SenselSerialBuffer cmd_bufs[3] =
+  {
+    { (unsigned char *)&cmd, 3 },
+    { buf, size },
+    { &checksum, 1 },
+  };
 
-  //Send checksum
-  if(!senselSerialWrite(serial, &checksum, 1))
+  if(!senselSerialWriteV(serial, cmd_bufs, 3))
     return SENSEL_ERROR;
 
-  if(!senselSerialReadBytes(serial, &ack, 1))
+  if(!_senselReadAck(device, serial, &ack))
     return SENSEL_ERROR;
 
   if (!senselSerialReadBytes(serial, (unsigned char *)&reg, 1))
     return SENSEL_ERROR;
 
-  if (device)
-  {
-    while(device->scan_mode == SCAN_MODE_ASYNC && ack == PT_ASYNC_DATA)
-    {
-      if(!_senselReadFrame(device))
-      {
-        printf("SENSEL ERROR: Error reading async frame.\n");
-      }
-
-      // Get the new ack
-      if(!senselSerialReadBytes(serial, (unsigned char *)&ack, 1))
-        return SENSEL_ERROR;
-    }
-  }
-
   if (ack != PT_WRITE_ACK)
     return SENSEL_ERROR;
 
   return SENSEL_OK;
 }
 
-SenselStatus _senselReadRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
-                              unsigned int buf_size, unsigned char *buf, unsigned int *read_size)
+static SenselStatus _senselReadRegVSTransaction(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                                                unsigned int buf_size, unsigned char *buf, unsigned int *read_size)
 {
+  SenselDevice    *device = (SenselDevice *)handle;
   unsigned short  read_size_buf;
   unsigned char   ack[3];
   unsigned char   checksum = 0;
   unsigned char   resp_checksum;
   int             i;
 
-  read_cmd.reg = reg;
-  read_cmd.size = 0;
+  sensel_protocol_cmd_t cmd = {SENSEL_READ_ADDR, reg, 0x00, 0x00};
+
+  if(device && device->reads_in_flight > 0)
+    _senselDrainFrameRequests(device);
+
+  senselSerialStartTimeout(serial);
 
-  if(!senselSerialWrite(serial, (unsigned char *)&(read_cmd), 3))
+  if(!senselSerialWrite(serial, (unsigned char *)&cmd, 3))
     return false;
 
-  if (!senselSerialReadBytes(serial, ack, 3))
+  if (!_senselReadAck(device, serial, &ack[0]) || !senselSerialReadBytes(serial, &ack[1], 2))
     printf("Unable to read RVS ack\n");
 
   if(!senselSerialReadBytes(serial, (unsigned char *)&(read_size_buf), 2))
@@ -196,28 +209,31 @@ SenselStatus _senselReadRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial,
   return SENSEL_OK;
 }
 
-SenselStatus _senselWriteRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
-                               unsigned int size, unsigned char *buf, unsigned int *write_size)
+static SenselStatus _senselWriteRegVSTransaction(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                                                 unsigned int size, unsigned char *buf, unsigned int *write_size)
 {
+  SenselDevice    *device     = (SenselDevice *)handle;
   unsigned char   ack;
   unsigned char   checksum    = 0;
   unsigned short  packet_size = 0;
   unsigned int    vs_index    = 0;
   int             i;
 
-  write_cmd_vs.reg          = reg;
-  write_cmd_vs.size         = 0;
-  write_cmd_vs.header_size  = DEFAULT_VS_HEADER_SIZE;
-  write_cmd_vs.vs_size      = size;
+  sensel_protocol_cmd_vs_t cmd_vs = {SENSEL_WRITE_ADDR, reg, 0x00, DEFAULT_VS_HEADER_SIZE, size, 0x00, 0x00};
+
+  unsigned char *cmd_vs_bytes = (unsigned char *)&cmd_vs;
+  cmd_vs.checksum = cmd_vs_bytes[4]+cmd_vs_bytes[5]+cmd_vs_bytes[6]+cmd_vs_bytes[7];
+
+  if(device && device->reads_in_flight > 0)
+    _senselDrainFrameRequests(device);
 
-  unsigned char *cmd_vs_bytes = (unsigned char *)&write_cmd_vs;
-  write_cmd_vs.checksum = cmd_vs_bytes[4]+cmd_vs_bytes[5]+cmd_vs_bytes[6]+cmd_vs_bytes[7];
+  senselSerialStartTimeout(serial);
 
   //Send write header
   if(!senselSerialWrite(serial, cmd_vs_bytes, 9))
     return SENSEL_ERROR;
 
-  if(!senselSerialReadBytes(serial, &ack, 1))
+  if(!_senselReadAck(device, serial, &ack))
     return SENSEL_ERROR;
 
   if (!senselSerialReadBytes(serial, &reg, 1))
@@ -234,20 +250,19 @@ SenselStatus _senselWriteRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial,
     for(i = 0; i < packet_size; i++)
       checksum += buf[vs_index+i];
 
-    //Send packet size
-    if(!senselSerialWrite(serial, (unsigned char *)&packet_size, 2))
-      return SENSEL_ERROR;
-
-    //Send data
-    if(!senselSerialWrite(serial, &buf[vs_index], packet_size))
-      return SENSEL_ERROR;
+    //Send packet size, data and checksum in one write
+    SenselSerialBuffer packet_bufs[3] =
+    {
+      { (unsigned char *)&packet_size, 2 },
+      { &buf[vs_index], packet_size },
+      { &checksum, 1 },
+    };
 
-    //Send checksum
-    if(!senselSerialWrite(serial, &checksum, 1))
+    if(!senselSerialWriteV(serial, packet_bufs, 3))
       return SENSEL_ERROR;
 
     //Read packet ack
-    if(!senselSerialReadBytes(serial, &ack, 1))
+    if(!_senselReadAck(device, serial, &ack))
       return SENSEL_ERROR;
 
     if (ack != PT_WVS_ACK)
@@ -261,3 +276,27 @@ SenselStatus _senselWriteRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial,
 
   return SENSEL_OK;
 }
+
+SenselStatus _senselReadReg(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                            unsigned char size, unsigned char *buf)
+{
+  return _senselEndTransaction(handle, _senselReadRegTransaction(handle, serial, reg, size, buf));
+}
+
+SenselStatus _senselWriteReg(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                             unsigned char size, unsigned char *buf)
+{
+  return _senselEndTransaction(handle, _senselWriteRegTransaction(handle, serial, reg, size, buf));
+}
+
+SenselStatus _senselReadRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                              unsigned int buf_size, unsigned char *buf, unsigned int *read_size)
+{
+  return _senselEndTransaction(handle, _senselReadRegVSTransaction(handle, serial, reg, buf_size, buf, read_size));
+}
+
+SenselStatus _senselWriteRegVS(SENSEL_HANDLE handle, SenselSerialHandle *serial, unsigned char reg,
+                               unsigned int size, unsigned char *buf, unsigned int *write_size)
+{
+  return _senselEndTransaction(handle, _senselWriteRegVSTransaction(handle, serial, reg, size, buf, write_size));
+}
@@ -43,6 +43,9 @@
 #define SENSEL_REG_DEPRECATED_SENSOR_COL_INTERP_FACTOR 0x12
 #define SENSEL_REG_DEPRECATED_SENSOR_ROW_INTERP_FACTOR 0x13
 
+#define SENSEL_READ_ADDR                               (DEFAULT_BOARD_ADDR | (1 << 7)) // Address byte of read commands
+#define SENSEL_WRITE_ADDR                              DEFAULT_BOARD_ADDR              // Address byte of write commands
+
 #define MAX_VS_PACKET_SIZE                             512
 #define DEFAULT_VS_HEADER_SIZE                         4
 
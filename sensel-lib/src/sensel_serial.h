@@ -27,6 +27,16 @@
 
 #include "sensel_device.h"
 
+#define SENSEL_SERIAL_DEFAULT_TIMEOUT_MS      1000 // Total time allowed for a register transaction or frame read
+#define SENSEL_SERIAL_DEFAULT_BYTE_TIMEOUT_MS 500  // Maximum time to wait for the next byte
+
+// One piece of a gather write
+typedef struct
+{
+  unsigned char *buf;
+  int           len;
+} SenselSerialBuffer;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,13 +45,28 @@ unsigned char senselSerialOpen                  (SenselSerialHandle *data, char*
 unsigned char senselSerialOpenDeviceByID        (SenselSerialHandle *data, unsigned char idx);
 unsigned char senselSerialOpenDeviceBySerialNum (SenselSerialHandle *data, char* serial_number);
 unsigned char senselSerialOpenDeviceByComPort   (SenselSerialHandle *data, char* com_port);
+unsigned char senselSerialOpenTransport         (SenselSerialHandle *data, SenselTransportType type, char* address);
 unsigned char senselSerialScan                  (SenselDeviceList *list);
 unsigned char senselSerialWrite                 (SenselSerialHandle *data, unsigned char* buf, int buf_len);
+unsigned char senselSerialWriteV                (SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs); // Writes all buffers in one call
 int           senselSerialReadAvailable         (SenselSerialHandle *data, unsigned char* buf, int buf_len);
 unsigned char senselSerialReadBytes             (SenselSerialHandle *data, unsigned char* buf, int buf_len);
 int           senselSerialGetAvailable          (SenselSerialHandle *data); // Checks number of available bytes
+int           senselSerialWait                  (SenselSerialHandle *data, int timeout_ms); // Waits for input: >0 available, 0 timeout, -1 error
 void          senselSerialFlushInput            (SenselSerialHandle *data);
+void          senselSerialSetTimeouts           (SenselSerialHandle *data, unsigned int timeout_ms, unsigned int byte_timeout_ms);
+void          senselSerialStartTimeout          (SenselSerialHandle *data); // Starts the deadline of a new transaction
 void          senselSerialClose                 (SenselSerialHandle *data);
+long long     senselSerialGetTimeUS             (void); // Monotonic host clock in microseconds
+unsigned char senselSerialIsDisconnected        (SenselSerialHandle *data); // May be called from any thread
+void          senselSerialSetDisconnected       (SenselSerialHandle *data);
+#ifndef WIN32
+void          senselSerialMarkDisconnected      (const char *address); // Fails every open handle on address
+int           senselSerialPeek                  (SenselSerialHandle *data, unsigned char* buf, int offset, int buf_len); // Copies input without consuming it
+int           senselSerialPeekAvailable         (SenselSerialHandle *data, unsigned char* buf, int offset, int buf_len); // Same, never waiting for more
+int           senselSerialWaitForMore           (SenselSerialHandle *data, int timeout_ms); // Waits for input past what is buffered
+void          senselSerialSkip                  (SenselSerialHandle *data, int len); // Drops buffered input
+#endif
 
 #ifdef __cplusplus
 }
@@ -22,76 +22,539 @@
 * SOFTWARE.
 ******************************************************************************************/
 
+#define _DEFAULT_SOURCE
+
 #include "sensel.h"
 #include "sensel_device.h"
 #include "sensel_serial.h"
+#include "sensel_transport.h"
 #include "sensel_register.h"
 #include "sensel_register_map.h"
+#ifdef __linux__
+  #include "sensel_device_vidpid.h"
+#endif
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <termios.h>
 #include <dirent.h>
+#include <errno.h>
 #include <string.h>
+#include <ctype.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <limits.h>
+#ifdef __linux__
+  #include <stdint.h>
+  #include <sys/eventfd.h>
+#endif
 
 #define SENSEL_SERIAL_DIR "/dev/"
+#define SENSEL_SERIAL_SYSFS_DIR "/sys/class/tty/"
 
-//TODO: Add a separate for flushing data
-#define SENSEL_SERIAL_TIMEOUT_SEC       0
-#define SENSEL_SERIAL_TIMEOUT_US        (500 * 1000) //500 ms
+// Initial size of the per-handle read-ahead ring. Must be a power of two. The ring grows up to the
+// maximum to hold a whole frame, so that a large one can be waited for without blocking.
+#define SENSEL_SERIAL_RX_BUFFER_SIZE      4096
+#define SENSEL_SERIAL_RX_BUFFER_MAX_SIZE  (1 << 20)
 
-//TODO: This list does not get updated on disconnects
-unsigned char    devices_scanned = 0;
-SenselDeviceList devlist;
+#define SENSEL_SERIAL_SCAN_MAX_CANDIDATES 64   // Serial ports considered by a single scan
+#define SENSEL_SERIAL_SCAN_MAX_WORKERS    8    // Threads probing candidates in parallel, besides the caller
 
-unsigned char senselSerialWrite(SenselSerialHandle *data, unsigned char *buf, int buf_len)
+// Result of the last scan, shared by every handle. The lock is held for the whole scan,
+// so concurrent senselGetDeviceList calls don't probe the same ports twice.
+typedef struct
+{
+  pthread_mutex_t     lock;
+  unsigned char       scanned;      // A scan has completed, list can be used to open devices
+  SenselDeviceList    list;         // Devices found by the last scan
+  unsigned char       cache_valid;  // list can be reused while the tty set matches signature
+  unsigned long long  signature;    // Identifies the set of tty nodes list was built from, see _senselSerialSysfsCandidates
+} SenselScanContext;
+
+static SenselScanContext scan_ctx = { PTHREAD_MUTEX_INITIALIZER };
+
+// Handles currently open, so that hotplug removals can fail them immediately
+static pthread_mutex_t    open_handles_lock     = PTHREAD_MUTEX_INITIALIZER;
+static SenselSerialHandle **open_handles        = NULL;
+static int                num_open_handles      = 0;
+static int                open_handles_capacity = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+// File descriptor transports (tty and Unix-domain socket)
+
+int senselTransportFdRead(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
 {
-  int wr = write(data->serial_fd, buf, buf_len);
+  struct iovec  iov[SENSEL_SERIAL_MAX_WRITE_BUFFERS];
+  int           i;
+  ssize_t       ret;
+
+  if(num_bufs > SENSEL_SERIAL_MAX_WRITE_BUFFERS)
+    return -1;
+
+  for(i = 0; i < num_bufs; i++)
+  {
+    iov[i].iov_base = bufs[i].buf;
+    iov[i].iov_len  = bufs[i].len;
+  }
+
+  ret = readv(data->serial_fd, iov, num_bufs);
+
+  if(ret == 0)
+  {
+    // End of file: the other end of the link went away
+    return -1;
+  }
+  else if(ret < 0)
+  {
+    if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      return 0;
+    perror("read returned -1");
+    return -1;
+  }
+  return (int)ret;
+}
+
+int senselTransportFdWrite(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
+{
+  struct iovec  iov[SENSEL_SERIAL_MAX_WRITE_BUFFERS];
+  int           i;
+  ssize_t       ret;
+
+  if(num_bufs > SENSEL_SERIAL_MAX_WRITE_BUFFERS)
+    return -1;
+
+  for(i = 0; i < num_bufs; i++)
+  {
+    iov[i].iov_base = bufs[i].buf;
+    iov[i].iov_len  = bufs[i].len;
+  }
 
   //THIS CAUSES READ FAILURE IN MAC OSX!!! tcflush(data->serial_fd, TCOFLUSH);
 
-  if(wr == -1)
+  ret = writev(data->serial_fd, iov, num_bufs);
+
+  if(ret < 0)
   {
+    if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      return 0;
     //perror("Write Error:");
+    return -1;
+  }
+  return (int)ret;
+}
+
+int senselTransportFdWait(SenselSerialHandle *data, unsigned char for_write, long long timeout_us)
+{
+  struct pollfd pfd[2];
+  int           num_fds = 1;
+  int           ret;
+
+  pfd[0].fd      = data->serial_fd;
+  pfd[0].events  = for_write ? POLLOUT : POLLIN;
+  pfd[0].revents = 0;
+
+  // A hotplug removal seen by another thread ends the wait without waiting for the link to hang up
+  if(data->wake_fd != -1)
+  {
+    pfd[1].fd      = data->wake_fd;
+    pfd[1].events  = POLLIN;
+    pfd[1].revents = 0;
+    num_fds++;
+  }
+
+  // Round up so that a short wait doesn't turn into a non-blocking poll
+  ret = poll(pfd, num_fds, (timeout_us < 0) ? -1 : (int)((timeout_us + 999) / 1000));
+
+  if(ret == -1)
+  {
+    if(errno == EINTR)
+      return 0;
+    perror("Error on poll()");
+  }
+  else if(num_fds > 1 && pfd[1].revents)
+  {
+    return -1;
+  }
+  return ret;
+}
+
+int senselTransportFdAvailable(SenselSerialHandle *data)
+{
+  int bytes_avail = 0;
+
+  ioctl(data->serial_fd, FIONREAD, &bytes_avail);
+
+  return bytes_avail;
+}
+
+void senselTransportFdClose(SenselSerialHandle *data)
+{
+  if(data->serial_fd != -1)
+  {
+    close(data->serial_fd);
+    data->serial_fd = -1;
+  }
+}
+
+static unsigned char _senselTransportTTYOpen(SenselSerialHandle *data, const char *address)
+{
+  struct termios options;
+
+  data->serial_fd = open(address, O_RDWR | O_NONBLOCK | O_NOCTTY);
+
+  if(data->serial_fd == -1)
+  {
     return 0;
   }
+
+  tcgetattr(data->serial_fd, &options);
+
+  options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP
+      | INLCR | IGNCR | ICRNL | IXON);
+  options.c_oflag &= ~OPOST;
+  options.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  options.c_cflag &= ~(CSIZE | PARENB);
+  options.c_cflag |= CS8;
+
+  cfsetispeed(&options, B115200);
+  cfsetospeed(&options, B115200);
+  tcsetattr(data->serial_fd, TCSANOW, &options);
+
   return 1;
 }
 
+void senselTransportFdFlush(SenselSerialHandle *data)
+{
+  tcflush(data->serial_fd, TCIFLUSH);
+}
+
+const SenselTransport senselTransportTTY =
+{
+  "tty",
+  _senselTransportTTYOpen,
+  senselTransportFdRead,
+  senselTransportFdWrite,
+  senselTransportFdWait,
+  senselTransportFdAvailable,
+  senselTransportFdFlush,
+  senselTransportFdClose,
+};
+
+const SenselTransport *senselTransportGet(SenselTransportType type)
+{
+  switch(type)
+  {
+    case SENSEL_TRANSPORT_TTY:          return &senselTransportTTY;
+    case SENSEL_TRANSPORT_UNIX_SOCKET:  return &senselTransportUnixSocket;
+    case SENSEL_TRANSPORT_MEMORY_PIPE:  return &senselTransportMemoryPipe;
+  }
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Transport independent buffering and timeouts
+
+long long senselSerialGetTimeUS(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void senselSerialSetTimeouts(SenselSerialHandle *data, unsigned int timeout_ms, unsigned int byte_timeout_ms)
+{
+  data->timeout_ms      = timeout_ms;
+  data->byte_timeout_ms = byte_timeout_ms;
+}
+
+void senselSerialStartTimeout(SenselSerialHandle *data)
+{
+  data->deadline_us = senselSerialGetTimeUS() + (long long)data->timeout_ms * 1000LL;
+}
+
+// Time to wait for the next byte: whatever is left of the transaction, capped by the inactivity timeout
+static long long _senselSerialGetWaitUS(SenselSerialHandle *data)
+{
+  long long wait_us = data->deadline_us - senselSerialGetTimeUS();
+
+  if(wait_us < 0)
+    wait_us = 0;
+
+  if(data->byte_timeout_ms > 0 && wait_us > (long long)data->byte_timeout_ms * 1000LL)
+    wait_us = (long long)data->byte_timeout_ms * 1000LL;
+
+  return wait_us;
+}
+
+unsigned char senselSerialWriteV(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
+{
+  SenselSerialBuffer  pending[SENSEL_SERIAL_MAX_WRITE_BUFFERS];
+  SenselSerialBuffer  *pending_ptr = pending;
+  int                 num_pending  = 0;
+  int                 i;
+
+  if(num_bufs > SENSEL_SERIAL_MAX_WRITE_BUFFERS)
+    return 0;
+
+  for(i = 0; i < num_bufs; i++)
+  {
+    if(bufs[i].len > 0)
+      pending[num_pending++] = bufs[i];
+  }
+
+  while(num_pending > 0)
+  {
+    int wr;
+
+    if(senselSerialIsDisconnected(data))
+      return 0;
+
+    wr = data->transport->write(data, pending_ptr, num_pending);
+
+    if(wr < 0)
+    {
+      senselSerialSetDisconnected(data);
+      return 0;
+    }
+
+    if(wr == 0)
+    {
+      // The output queue is full, wait until it drains or the transaction times out
+      if(data->transport->wait(data, true, _senselSerialGetWaitUS(data)) <= 0)
+        return 0;
+      continue;
+    }
+
+    // Skip over what was written. Partial writes leave us in the middle of a buffer.
+    while(num_pending > 0 && wr >= pending_ptr->len)
+    {
+      wr -= pending_ptr->len;
+      pending_ptr++;
+      num_pending--;
+    }
+    if(num_pending > 0)
+    {
+      pending_ptr->buf += wr;
+      pending_ptr->len -= wr;
+    }
+  }
+
+  return 1;
+}
+
+unsigned char senselSerialWrite(SenselSerialHandle *data, unsigned char *buf, int buf_len)
+{
+  SenselSerialBuffer buffer = { buf, buf_len };
+
+  return senselSerialWriteV(data, &buffer, 1);
+}
+
+// Copies up to buf_len bytes out of the receive ring, returns the number of bytes copied
+static int _senselSerialRingRead(SenselSerialHandle *data, unsigned char *buf, int buf_len)
+{
+  unsigned int mask  = data->rx_capacity - 1;
+  unsigned int count = (unsigned int)buf_len < data->rx_count ? (unsigned int)buf_len : data->rx_count;
+  unsigned int first = data->rx_capacity - data->rx_head;
+
+  if(first > count)
+    first = count;
+
+  memcpy(buf, &data->rx_buffer[data->rx_head], first);
+  memcpy(buf + first, data->rx_buffer, count - first);
+
+  data->rx_head   = (data->rx_head + count) & mask;
+  data->rx_count -= count;
+
+  return count;
+}
+
+// Fills the free space of the receive ring with a single read, returns the number of bytes received
+static int _senselSerialRingFill(SenselSerialHandle *data)
+{
+  SenselSerialBuffer  bufs[2];
+  unsigned int        mask = data->rx_capacity - 1;
+  unsigned int        tail;
+  int                 num_bufs;
+  int                 ret;
+
+  // Restart at the beginning of the ring when it is empty so the free space is contiguous
+  if(data->rx_count == 0)
+    data->rx_head = 0;
+
+  tail = (data->rx_head + data->rx_count) & mask;
+
+  bufs[0].buf = &data->rx_buffer[tail];
+  if(tail >= data->rx_head && data->rx_count < data->rx_capacity)
+  {
+    bufs[0].len = data->rx_capacity - tail;
+    bufs[1].buf = data->rx_buffer;
+    bufs[1].len = data->rx_head;
+    num_bufs = (data->rx_head > 0) ? 2 : 1;
+  }
+  else
+  {
+    bufs[0].len = data->rx_capacity - data->rx_count;
+    num_bufs = 1;
+  }
+
+  ret = data->transport->read(data, bufs, num_bufs);
+
+  if(ret > 0)
+  {
+    data->rx_count  += ret;
+    data->rx_bytes  += ret;
+    data->rx_time_us = senselSerialGetTimeUS();
+  }
+
+  return ret;
+}
+
+// Grows the receive ring to hold at least size bytes, keeping the unread input at its start
+static unsigned char _senselSerialRingGrow(SenselSerialHandle *data, unsigned int size)
+{
+  unsigned int  capacity = data->rx_capacity;
+  unsigned char *buffer;
+  unsigned int  count;
+
+  if(size > SENSEL_SERIAL_RX_BUFFER_MAX_SIZE)
+    return false;
+  while(capacity < size)
+    capacity <<= 1;
+
+  buffer = (unsigned char *)malloc(capacity);
+  if(!buffer)
+    return false;
+
+  count = _senselSerialRingRead(data, buffer, data->rx_count);
+  free(data->rx_buffer);
+  data->rx_buffer   = buffer;
+  data->rx_capacity = capacity;
+  data->rx_head     = 0;
+  data->rx_count    = count;
+  return true;
+}
+
+// Copies buf_len bytes that are offset bytes into the unread input, without consuming them. Waits for them as
+// long as the current transaction allows when wait is set. Returns the number of bytes copied, which is short
+// if they did not arrive in time, or -1 if they can never fit in the receive ring, even grown to its maximum.
+static int _senselSerialPeek(SenselSerialHandle *data, unsigned char *buf, int offset, int buf_len, unsigned char wait)
+{
+  unsigned int mask = data->rx_capacity - 1;
+  unsigned int want = (unsigned int)(offset + buf_len);
+  unsigned int count;
+  unsigned int i;
+
+  if(want > data->rx_capacity && !_senselSerialRingGrow(data, want))
+    return -1;
+
+  while(data->rx_count < want && !senselSerialIsDisconnected(data))
+  {
+    int ret = data->transport->wait(data, false, wait ? _senselSerialGetWaitUS(data) : 0);
+
+    if(ret <= 0)
+      break;
+
+    ret = _senselSerialRingFill(data);
+    if(ret < 0)
+      senselSerialSetDisconnected(data);
+    if(ret <= 0)
+      break;
+  }
+
+  if(data->rx_count <= (unsigned int)offset)
+    return 0;
+
+  count = data->rx_count - offset;
+  if(count > (unsigned int)buf_len)
+    count = buf_len;
+
+  for(i = 0; i < count; i++)
+    buf[i] = data->rx_buffer[(data->rx_head + offset + i) & mask];
+
+  return (int)count;
+}
+
+int senselSerialPeek(SenselSerialHandle *data, unsigned char *buf, int offset, int buf_len)
+{
+  return _senselSerialPeek(data, buf, offset, buf_len, true);
+}
+
+// Like senselSerialPeek, but only looks at input that has already arrived
+int senselSerialPeekAvailable(SenselSerialHandle *data, unsigned char *buf, int offset, int buf_len)
+{
+  return _senselSerialPeek(data, buf, offset, buf_len, false);
+}
+
+// Drops up to len bytes of buffered input
+void senselSerialSkip(SenselSerialHandle *data, int len)
+{
+  if((unsigned int)len > data->rx_count)
+    len = data->rx_count;
+
+  data->rx_head   = (data->rx_head + len) & (data->rx_capacity - 1);
+  data->rx_count -= len;
+}
+
 int senselSerialReadAvailable(SenselSerialHandle *data, unsigned char *buf, int buf_len)
 {
-  fd_set read_fds;
+  long long wait_us;
+  int       ret;
 
-  FD_ZERO(&read_fds);
-  FD_SET(data->serial_fd, &read_fds);
+  // Serve the request from the read-ahead ring if it already holds data
+  if(data->rx_count > 0)
+    return _senselSerialRingRead(data, buf, buf_len);
 
-  //select() changes timeout value, so we need this on every call to readAvailable
-  struct timeval timeout;
-  timeout.tv_sec  = SENSEL_SERIAL_TIMEOUT_SEC;
-  timeout.tv_usec = SENSEL_SERIAL_TIMEOUT_US;
+  // Don't wait on a device that is gone
+  if(senselSerialIsDisconnected(data))
+    return -1;
 
-  //select() uses fd + 1
-  int ret = select(data->serial_fd + 1, &read_fds, NULL, NULL, &timeout);
+  wait_us = _senselSerialGetWaitUS(data);
+  ret = data->transport->wait(data, false, wait_us);
 
-  if(ret == -1) //Select error
+  if(ret == -1) //Wait error
   {
-    perror("Error on select()");
     return -1;
   }
   else if (ret > 0) //We have bytes to read!
   {
-    ret = read(data->serial_fd, buf, buf_len);
+    // Large requests bypass the ring and are read straight into the caller's buffer
+    if((unsigned int)buf_len >= data->rx_capacity)
+    {
+      SenselSerialBuffer buffer = { buf, buf_len };
+      ret = data->transport->read(data, &buffer, 1);
+      if(ret > 0)
+      {
+        data->rx_bytes  += ret;
+        data->rx_time_us = senselSerialGetTimeUS();
+      }
+    }
+    else
+    {
+      ret = _senselSerialRingFill(data);
+      if(ret > 0)
+        ret = _senselSerialRingRead(data, buf, buf_len);
+    }
 
+    // Readable with nothing to read is a hang up. Remember it so later calls fail right away.
     if(ret < 0)
-      perror("read returned -1");
+      senselSerialSetDisconnected(data);
 
     return ret;
   }
   else //No data available after timeout
   {
-    printf("[fd:%d] select() timedout with no data, ret=%d\n", data->serial_fd, ret);
+    // A zero wait is a non-blocking attempt, so running out of data there is not worth reporting
+    if(wait_us > 0)
+    {
+      printf("[%s] wait timed out with no data\n", data->transport->name);
+      data->rx_timeouts++;
+    }
     return 0;
   }
 }
@@ -126,14 +589,39 @@ unsigned char senselSerialReadBytes(SenselSerialHandle *data, unsigned char *buf
   return 1;
 }
 
-// TODO: I have not tested this on Linux!!!
+unsigned char senselSerialIsDisconnected(SenselSerialHandle *data)
+{
+  return __atomic_load_n(&data->disconnected, __ATOMIC_ACQUIRE);
+}
+
+void senselSerialSetDisconnected(SenselSerialHandle *data)
+{
+  __atomic_store_n(&data->disconnected, true, __ATOMIC_RELEASE);
+}
+
 int senselSerialGetAvailable(SenselSerialHandle *data)
 {
-  int bytes_avail;
+  return data->transport->available(data) + data->rx_count;
+}
 
-  ioctl(data->serial_fd, FIONREAD, &bytes_avail);
+int senselSerialWait(SenselSerialHandle *data, int timeout_ms)
+{
+  // Bytes already read ahead won't make the transport ready again
+  if(data->rx_count > 0)
+    return 1;
+  if(senselSerialIsDisconnected(data))
+    return -1;
 
-  return bytes_avail;
+  return data->transport->wait(data, false, (timeout_ms < 0) ? -1 : (long long)timeout_ms * 1000LL);
+}
+
+// Unlike senselSerialWait, ignores bytes already read ahead. Used when those don't make up a whole response.
+int senselSerialWaitForMore(SenselSerialHandle *data, int timeout_ms)
+{
+  if(senselSerialIsDisconnected(data))
+    return -1;
+
+  return data->transport->wait(data, false, (timeout_ms < 0) ? -1 : (long long)timeout_ms * 1000LL);
 }
 
 void senselSerialFlushInput(SenselSerialHandle *data)
@@ -142,6 +630,13 @@ void senselSerialFlushInput(SenselSerialHandle *data)
   int           byte_total = 0;
   unsigned char buf[128];
 
+  // Drop anything already buffered in the receive ring
+  data->rx_head  = 0;
+  data->rx_count = 0;
+
+  data->transport->flush(data);
+  senselSerialStartTimeout(data);
+
   //Read while there are bytes available
   do
   {
@@ -151,32 +646,118 @@ void senselSerialFlushInput(SenselSerialHandle *data)
   while(bytes_read > 0);
 }
 
-unsigned char senselSerialOpen2(SenselSerialHandle *data, char* file_name)
+static void _senselSerialRegisterHandle(SenselSerialHandle *data)
+{
+  pthread_mutex_lock(&open_handles_lock);
+  if(num_open_handles == open_handles_capacity)
+  {
+    int                 capacity = open_handles_capacity ? open_handles_capacity * 2 : SENSEL_MAX_DEVICES;
+    SenselSerialHandle  **handles = (SenselSerialHandle **)realloc(open_handles, capacity * sizeof(SenselSerialHandle *));
+
+    // Without room the handle just won't be notified by hotplug, it still detects the hang up on its own
+    if(!handles)
+    {
+      pthread_mutex_unlock(&open_handles_lock);
+      return;
+    }
+    open_handles          = handles;
+    open_handles_capacity = capacity;
+  }
+  open_handles[num_open_handles++] = data;
+  pthread_mutex_unlock(&open_handles_lock);
+}
+
+static void _senselSerialUnregisterHandle(SenselSerialHandle *data)
+{
+  int i;
+
+  pthread_mutex_lock(&open_handles_lock);
+  for(i = 0; i < num_open_handles; i++)
+  {
+    if(open_handles[i] == data)
+    {
+      open_handles[i] = open_handles[--num_open_handles];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&open_handles_lock);
+}
+
+void senselSerialMarkDisconnected(const char *address)
+{
+  int i;
+
+  pthread_mutex_lock(&open_handles_lock);
+  for(i = 0; i < num_open_handles; i++)
+  {
+    if(strcmp(open_handles[i]->address, address) == 0)
+    {
+      senselSerialSetDisconnected(open_handles[i]);
+#ifdef __linux__
+      if(open_handles[i]->wake_fd != -1)
+      {
+        uint64_t val = 1;
+        if(write(open_handles[i]->wake_fd, &val, sizeof(val)) < 0)
+          perror("write wake fd");
+      }
+#endif //__linux__
+    }
+  }
+  pthread_mutex_unlock(&open_handles_lock);
+}
+
+static unsigned char _senselSerialOpenTransport(SenselSerialHandle *data, const SenselTransport *transport, const char *address)
 {
   char magic[7];
 
   magic[6] = '\0';
 
-  data->serial_fd = open(file_name, O_RDWR | O_NONBLOCK | O_NOCTTY);
+  data->transport     = transport;
+  data->transport_ctx = NULL;
+  data->serial_fd     = -1;
+  data->rx_buffer     = NULL;
+  data->rx_capacity   = 0;
+  data->rx_head       = 0;
+  data->rx_count      = 0;
+  data->address[0]    = 0;
+  data->disconnected  = false;
+  data->wake_fd       = -1;
+  data->rx_time_us    = 0;
+  data->rx_bytes      = 0;
+  data->rx_timeouts   = 0;
 
-  if(data->serial_fd == -1)
+  senselSerialSetTimeouts(data, SENSEL_SERIAL_DEFAULT_TIMEOUT_MS, SENSEL_SERIAL_DEFAULT_BYTE_TIMEOUT_MS);
+  senselSerialStartTimeout(data);
+
+  if(!transport->open(data, address))
   {
+    data->transport = NULL;
     return 0;
   }
 
-  struct termios options;
-  tcgetattr(data->serial_fd, &options);
+  // Keep the resolved path so that a hotplug removal of /dev/ttyACM0 matches a handle opened through a symlink
+  {
+    char resolved[PATH_MAX];
 
-  options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP
-      | INLCR | IGNCR | ICRNL | IXON);
-  options.c_oflag &= ~OPOST;
-  options.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-  options.c_cflag &= ~(CSIZE | PARENB);
-  options.c_cflag |= CS8;
+    if(transport != &senselTransportTTY || !realpath(address, resolved))
+      strncpy(resolved, address, sizeof(resolved) - 1);
+    resolved[sizeof(data->address) - 1] = 0;
+    strcpy(data->address, resolved);
+  }
+#ifdef __linux__
+  // Only signalled, never read: once set the handle stays disconnected
+  data->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif //__linux__
+  _senselSerialRegisterHandle(data);
 
-  cfsetispeed(&options, B115200);
-  cfsetospeed(&options, B115200);
-  tcsetattr(data->serial_fd, TCSANOW, &options);
+  data->rx_buffer = (unsigned char*)malloc(SENSEL_SERIAL_RX_BUFFER_SIZE);
+  if(!data->rx_buffer)
+  {
+    printf("Unable to allocate serial receive buffer!\n");
+    senselSerialClose(data);
+    return 0;
+  }
+  data->rx_capacity = SENSEL_SERIAL_RX_BUFFER_SIZE;
 
   //senselSerialFlushInput(data);
 
@@ -188,11 +769,25 @@ unsigned char senselSerialOpen2(SenselSerialHandle *data, char* file_name)
     }
   }
 
-  close(data->serial_fd);
-  data->serial_fd = -1;
+  senselSerialClose(data);
   return 0;
 }
 
+unsigned char senselSerialOpen2(SenselSerialHandle *data, char* file_name)
+{
+  return _senselSerialOpenTransport(data, &senselTransportTTY, file_name);
+}
+
+unsigned char senselSerialOpenTransport(SenselSerialHandle *data, SenselTransportType type, char *address)
+{
+  const SenselTransport *transport = senselTransportGet(type);
+
+  if(!transport || !address)
+    return 0;
+
+  return _senselSerialOpenTransport(data, transport, address);
+}
+
 unsigned char senselSerialOpen(SenselSerialHandle *data, char* com_port)
 {
   DIR           *d;
@@ -238,67 +833,349 @@ unsigned char senselSerialOpen(SenselSerialHandle *data, char* com_port)
 
 unsigned char senselSerialOpenDeviceByID(SenselSerialHandle *data, unsigned char idx)
 {
-  int i;
+  char  file_name[sizeof(scan_ctx.list.devices[0].com_port)];
+  int   i;
 
-  if(!devices_scanned)
+  file_name[0] = 0;
+
+  pthread_mutex_lock(&scan_ctx.lock);
+  if(!scan_ctx.scanned)
   {
+    pthread_mutex_unlock(&scan_ctx.lock);
     printf("senselSerialOpenDeviceByID. Need to call senselGetDeviceList first\n");
     return 0;
   }
 
-  for (i = 0; i < devlist.num_devices; i++)
+  for (i = 0; i < scan_ctx.list.num_devices; i++)
   {
-    if (devlist.devices[i].idx == idx)
-      return senselSerialOpen2(data, (char*)devlist.devices[i].com_port);
+    if (scan_ctx.list.devices[i].idx == idx)
+    {
+      strcpy(file_name, (char*)scan_ctx.list.devices[i].com_port);
+      break;
+    }
   }
-  return 0;
+  pthread_mutex_unlock(&scan_ctx.lock);
+
+  // Open outside of the lock, a slow device must not hold up scans or other opens
+  if(!file_name[0])
+    return 0;
+  return senselSerialOpen2(data, file_name);
 }
 
 unsigned char senselSerialOpenDeviceBySerialNum(SenselSerialHandle *data, char *serial_num)
 {
-  int i;
+  char  file_name[sizeof(scan_ctx.list.devices[0].com_port)];
+  int   i;
+
+  file_name[0] = 0;
 
-  if(!devices_scanned)
+  pthread_mutex_lock(&scan_ctx.lock);
+  if(!scan_ctx.scanned)
   {
+    pthread_mutex_unlock(&scan_ctx.lock);
     printf("senselSerialOpenDeviceBySerialNum. Need to call senselGetDeviceList first\n");
     return 0;
   }
 
-  for (i = 0; i < devlist.num_devices; i++)
+  for (i = 0; i < scan_ctx.list.num_devices; i++)
   {
-    if (!strcmp((char *)serial_num, (char *)devlist.devices[i].serial_num))
-      return senselSerialOpen2(data, (char*)devlist.devices[i].com_port);
+    if (!strcmp((char *)serial_num, (char *)scan_ctx.list.devices[i].serial_num))
+    {
+      strcpy(file_name, (char*)scan_ctx.list.devices[i].com_port);
+      break;
+    }
   }
-  return 0;
+  pthread_mutex_unlock(&scan_ctx.lock);
+
+  // Open outside of the lock, a slow device must not hold up scans or other opens
+  if(!file_name[0])
+    return 0;
+  return senselSerialOpen2(data, file_name);
 }
 
 unsigned char senselSerialOpenDeviceByComPort(SenselSerialHandle *data, char *com_port)
 {
-  int i;
+  char  file_name[sizeof(scan_ctx.list.devices[0].com_port)];
+  int   i;
+
+  file_name[0] = 0;
 
-  if(!devices_scanned)
+  pthread_mutex_lock(&scan_ctx.lock);
+  if(!scan_ctx.scanned)
   {
+    pthread_mutex_unlock(&scan_ctx.lock);
     printf("senselSerialOpenByComPort. Need to call senselGetDeviceList first\n");
     return 0;
   }
 
-  for (i = 0; i < devlist.num_devices; i++)
+  for (i = 0; i < scan_ctx.list.num_devices; i++)
   {
-    if (!strcmp((char*)com_port, (char*)devlist.devices[i].com_port))
-      return senselSerialOpen2(data, (char*)devlist.devices[i].com_port);
+    if (!strcmp((char*)com_port, (char*)scan_ctx.list.devices[i].com_port))
+    {
+      strcpy(file_name, (char*)scan_ctx.list.devices[i].com_port);
+      break;
+    }
   }
-  return 0;
+  pthread_mutex_unlock(&scan_ctx.lock);
+
+  // Open outside of the lock, a slow device must not hold up scans or other opens
+  if(!file_name[0])
+    return 0;
+  return senselSerialOpen2(data, file_name);
 }
 
-unsigned char senselSerialScan(SenselDeviceList *list)
+// A serial port that might be a Sensel device, probed by one of the scan workers
+typedef struct
+{
+  char            file_name[sizeof(((SenselDeviceID *)0)->com_port)];  // Longer names couldn't be reopened by com port
+  unsigned char   found;                // Set by the worker when the device answered with the Sensel magic
+  SenselDeviceID  devid;                // Filled in by the worker when found is set
+} SenselScanCandidate;
+
+typedef struct
+{
+  pthread_mutex_t     lock;
+  SenselScanCandidate *candidates;
+  int                 num_candidates;
+  int                 next_candidate;   // Index of the next candidate to probe
+} SenselScanJob;
+
+static void _senselSerialProbe(SenselScanCandidate *candidate)
 {
-  SenselStatus        status;
   SenselSerialHandle  serial;
-  DIR                 *d;
-  struct dirent       *dir;
-  char                file_name[128];
-  unsigned char       found_sensor    = 0;
-  unsigned char       num_devices     = 0;
+  SenselDeviceID      *devid = &candidate->devid;
+  unsigned int        num_chars;
+  int                 i;
+
+  printf("Found device: %s\n", candidate->file_name);
+
+  if(!senselSerialOpen2(&serial, candidate->file_name))
+    return;
+
+  if(_senselReadRegVS(NULL, &serial, SENSEL_REG_DEVICE_SERIAL_NUMBER, sizeof(devid->serial_num) - 1,
+                      (unsigned char*)devid->serial_num, &num_chars) == SENSEL_OK)
+  {
+    // TODO: This is an issue in the firmware code where although the firmware reports a 16 byte long serial, only 13
+    //       of them are actually valid. As a consequence, scan through the string and replace 0xFF with 0.
+    for (i = 0; i < num_chars; i++)
+      devid->serial_num[i] = (devid->serial_num[i]== 0xFF) ? 0 : devid->serial_num[i];
+
+    devid->serial_num[num_chars] = 0;
+    snprintf((char*)devid->com_port, sizeof(devid->com_port), "%s", candidate->file_name);
+    candidate->found = true;
+  }
+
+  senselSerialClose(&serial);
+}
+
+static void *_senselSerialScanWorker(void *arg)
+{
+  SenselScanJob *job = (SenselScanJob *)arg;
+  int           idx;
+
+  while(1)
+  {
+    pthread_mutex_lock(&job->lock);
+    idx = job->next_candidate++;
+    pthread_mutex_unlock(&job->lock);
+
+    if(idx >= job->num_candidates)
+      break;
+
+    // Candidates identified from sysfs don't need to be opened
+    if(!job->candidates[idx].found)
+      _senselSerialProbe(&job->candidates[idx]);
+  }
+  return NULL;
+}
+
+// Orders names so that digit runs compare by value (ttyACM2 before ttyACM10)
+static int _senselSerialCompareCandidates(const void *a, const void *b)
+{
+  const char *sa = ((const SenselScanCandidate *)a)->file_name;
+  const char *sb = ((const SenselScanCandidate *)b)->file_name;
+
+  while(*sa && *sb)
+  {
+    if(isdigit((unsigned char)*sa) && isdigit((unsigned char)*sb))
+    {
+      unsigned long va = strtoul(sa, (char **)&sa, 10);
+      unsigned long vb = strtoul(sb, (char **)&sb, 10);
+
+      if(va != vb)
+        return (va < vb) ? -1 : 1;
+    }
+    else
+    {
+      if(*sa != *sb)
+        return (unsigned char)*sa - (unsigned char)*sb;
+      sa++;
+      sb++;
+    }
+  }
+  return (unsigned char)*sa - (unsigned char)*sb;
+}
+
+#ifdef __linux__
+// Reads a one line sysfs attribute, stripping the trailing newline
+static unsigned char _senselSerialReadSysfsAttr(const char *dir_name, const char *attr, char *buf, int buf_size)
+{
+  char  path[PATH_MAX];
+  FILE  *f;
+  int   len;
+
+  snprintf(path, sizeof(path), "%s/%s", dir_name, attr);
+
+  f = fopen(path, "r");
+  if(!f)
+    return false;
+
+  if(!fgets(buf, buf_size, f))
+  {
+    fclose(f);
+    return false;
+  }
+  fclose(f);
+
+  len = (int)strlen(buf);
+  while(len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r'))
+    buf[--len] = 0;
+
+  return true;
+}
+
+// Fills in a candidate for tty_name if it belongs to a supported USB device.
+// The USB device directory holding idVendor is the parent of the interface the tty is bound to.
+static unsigned char _senselSerialSysfsCandidate(const char *tty_name, SenselScanCandidate *candidate)
+{
+  char          link[PATH_MAX];
+  char          usb_dir[PATH_MAX];
+  char          value[64];
+  char          *sep;
+  unsigned long vid;
+  int           level;
+  unsigned int  i;
+
+  snprintf(link, sizeof(link), SENSEL_SERIAL_SYSFS_DIR "%s/device", tty_name);
+  if(!realpath(link, usb_dir))
+    return false;
+
+  for(level = 0; level < 3; level++)
+  {
+    if(_senselSerialReadSysfsAttr(usb_dir, "idVendor", value, sizeof(value)))
+      break;
+
+    sep = strrchr(usb_dir, '/');
+    if(!sep || sep == usb_dir)
+      return false;
+    *sep = 0;
+  }
+  if(level == 3)
+    return false;
+
+  vid = strtoul(value, NULL, 16);
+  for(i = 0; i < NUM_SUPPORTED_DEVS; i++)
+  {
+    if(supported_devices[i].vid == vid)
+      break;
+  }
+  if(i == NUM_SUPPORTED_DEVS)
+    return false;
+
+  memset(candidate, 0, sizeof(SenselScanCandidate));
+  strcpy(candidate->file_name, SENSEL_SERIAL_DIR);
+  strcat(candidate->file_name, tty_name);
+
+  // Sensel firmware reports the same string as the USB iSerial descriptor and as
+  // SENSEL_REG_DEVICE_SERIAL_NUMBER, so the sysfs serial stands in for the register read.
+  // A serial that couldn't have come from the register (too long, or not printable) is
+  // probed as before, as is a device without one.
+  if(_senselSerialReadSysfsAttr(usb_dir, "serial", value, sizeof(value)) && value[0] &&
+     strlen(value) < sizeof(candidate->devid.serial_num))
+  {
+    for(sep = value; *sep && isprint((unsigned char)*sep); sep++);
+    if(*sep)
+      return true;
+
+    snprintf((char*)candidate->devid.serial_num, sizeof(candidate->devid.serial_num), "%s", value);
+    snprintf((char*)candidate->devid.com_port, sizeof(candidate->devid.com_port), "%s", candidate->file_name);
+    candidate->found = true;
+  }
+  return true;
+}
+
+// Lists candidates from the USB identity of each tty, without opening anything.
+// Returns false when sysfs is not available. When the set of tty nodes hasn't changed
+// since the last complete scan, *cache_hit is set and no candidate is listed.
+// A name alone isn't enough to tell the set hasn't changed: a pad unplugged and another
+// plugged in gets the same ttyACMn. The /dev node is recreated on every plug though, so
+// its inode and change time are part of the signature too.
+static unsigned char _senselSerialSysfsCandidates(SenselScanJob *job, unsigned long long *signature, unsigned char *cache_hit)
+{
+  DIR           *d;
+  struct dirent *dir;
+
+  *cache_hit = false;
+  *signature = 0;
+
+  d = opendir(SENSEL_SERIAL_SYSFS_DIR);
+  if(!d)
+    return false;
+
+  // Order independent hash of the tty names, so the check doesn't depend on readdir order
+  while((dir = readdir(d)) != 0)
+  {
+    unsigned long long  hash = 14695981039346656037ULL;
+    const char          *c;
+    char                node[PATH_MAX];
+    struct stat         st;
+
+    if(dir->d_name[0] == '.')
+      continue;
+
+    for(c = dir->d_name; *c; c++)
+      hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+
+    snprintf(node, sizeof(node), SENSEL_SERIAL_DIR "%s", dir->d_name);
+    if(stat(node, &st) == 0)
+    {
+      hash = (hash ^ (unsigned long long)st.st_ino) * 1099511628211ULL;
+      hash = (hash ^ (unsigned long long)st.st_ctim.tv_sec) * 1099511628211ULL;
+      hash = (hash ^ (unsigned long long)st.st_ctim.tv_nsec) * 1099511628211ULL;
+    }
+    *signature += hash;
+  }
+
+  if(scan_ctx.cache_valid && *signature == scan_ctx.signature)
+  {
+    closedir(d);
+    *cache_hit = true;
+    return true;
+  }
+
+  rewinddir(d);
+  while((dir = readdir(d)) != 0 && job->num_candidates < SENSEL_SERIAL_SCAN_MAX_CANDIDATES)
+  {
+    if(dir->d_name[0] == '.')
+      continue;
+
+    if(strlen(SENSEL_SERIAL_DIR) + strlen(dir->d_name) >= sizeof(job->candidates[0].file_name))
+      continue;
+
+    if(_senselSerialSysfsCandidate(dir->d_name, &job->candidates[job->num_candidates]))
+      job->num_candidates++;
+  }
+
+  closedir(d);
+  return true;
+}
+#endif //__linux__
+
+// Lists candidates by name from /dev. Each one has to be probed to find out whether it is a Sensel device.
+static unsigned char _senselSerialDevCandidates(SenselScanJob *job)
+{
+  DIR           *d;
+  struct dirent *dir;
 
   d = opendir(SENSEL_SERIAL_DIR);
   if(!d)
@@ -307,11 +1184,10 @@ unsigned char senselSerialScan(SenselDeviceList *list)
     return false;
   }
 
-  memset(&devlist, 0, sizeof(SenselDeviceList));
-
-  while((dir = readdir(d)) != 0)
+  while((dir = readdir(d)) != 0 && job->num_candidates < SENSEL_SERIAL_SCAN_MAX_CANDIDATES)
   {
-    strcpy(file_name, SENSEL_SERIAL_DIR);
+    if(strlen(SENSEL_SERIAL_DIR) + strlen(dir->d_name) >= sizeof(job->candidates[0].file_name))
+      continue;
 
     if(strstr(dir->d_name, "morph")  ||
        strstr(dir->d_name, "squirt") ||
@@ -319,50 +1195,127 @@ unsigned char senselSerialScan(SenselDeviceList *list)
        strstr(dir->d_name, "tty.usbmodem") ||
        strstr(dir->d_name, "cu.usbmodem"))
     {
-      printf("Found device: %s\n", dir->d_name);
-      strcat(file_name, dir->d_name);
-      found_sensor = senselSerialOpen2(&serial, file_name);
-      if (found_sensor)
-      {
-        SenselDeviceID *devid = &devlist.devices[num_devices];
-        unsigned int num_chars;
-
-        status = _senselReadRegVS(NULL, &serial, SENSEL_REG_DEVICE_SERIAL_NUMBER, sizeof(devid->serial_num),
-                                  (unsigned char*)devid->serial_num, &num_chars);
-        if (status != SENSEL_OK)
-        {
-          senselSerialClose(&serial);
-          continue;
-        }
-
-        // TODO: This is an issue in the firmware code where although the firmware reports a 16 byte long serial, only 13
-        //       of them are actually valid. As a consequence, scan through the string and replace 0xFF with 0.
-        for (int i = 0; i < num_chars; i++)
-          devid->serial_num[i] = (devid->serial_num[i]== 0xFF) ? 0 : devid->serial_num[i];
-
-        devid->idx = num_devices;
-        devid->serial_num[num_chars] = 0;
-        strncpy((char*)devid->com_port, file_name, sizeof(devid->com_port));
-        devlist.num_devices = ++num_devices;
-      }
-      senselSerialClose(&serial);
-      if (num_devices == SENSEL_MAX_DEVICES)
-        break;
+      SenselScanCandidate *candidate = &job->candidates[job->num_candidates++];
+
+      memset(candidate, 0, sizeof(SenselScanCandidate));
+      strcpy(candidate->file_name, SENSEL_SERIAL_DIR);
+      strcat(candidate->file_name, dir->d_name);
     }
   }
 
-  devices_scanned = true;
-  memcpy(list, &devlist, sizeof(SenselDeviceList));
-
   closedir(d);
+  return true;
+}
+
+// Called with scan_ctx.lock held
+static unsigned char _senselSerialScanLocked(SenselDeviceList *list)
+{
+  SenselScanCandidate candidates[SENSEL_SERIAL_SCAN_MAX_CANDIDATES];
+  SenselScanJob       job;
+  pthread_t           workers[SENSEL_SERIAL_SCAN_MAX_WORKERS];
+  int                 num_workers     = 0;
+  unsigned char       num_devices     = 0;
+  unsigned char       from_sysfs      = false;
+  unsigned char       all_found       = true;
+  unsigned long long  signature       = 0;
+  int                 i;
+
+  memset(&job, 0, sizeof(SenselScanJob));
+  job.candidates = candidates;
+
+#ifdef __linux__
+  {
+    unsigned char cache_hit;
+
+    from_sysfs = _senselSerialSysfsCandidates(&job, &signature, &cache_hit);
+    if(cache_hit)
+    {
+      memcpy(list, &scan_ctx.list, sizeof(SenselDeviceList));
+      return scan_ctx.list.num_devices;
+    }
+  }
+#endif //__linux__
+
+  if(!from_sysfs && !_senselSerialDevCandidates(&job))
+    return false;
+
+  // readdir order is arbitrary, sort so that device indices are stable from one scan to the next
+  qsort(candidates, job.num_candidates, sizeof(SenselScanCandidate), _senselSerialCompareCandidates);
+
+  // Probe candidates concurrently. Each probe mostly waits on the device, so a small pool hides the round trips.
+  pthread_mutex_init(&job.lock, NULL);
+  for(i = 0; i < SENSEL_SERIAL_SCAN_MAX_WORKERS && i < job.num_candidates - 1; i++)
+  {
+    if(pthread_create(&workers[num_workers], NULL, _senselSerialScanWorker, &job) != 0)
+      break;
+    num_workers++;
+  }
+
+  // The calling thread takes part as well, which also covers the case where no worker could be started
+  _senselSerialScanWorker(&job);
+
+  for(i = 0; i < num_workers; i++)
+    pthread_join(workers[i], NULL);
+  pthread_mutex_destroy(&job.lock);
+
+  // Collect results in candidate order regardless of the order in which probes completed
+  memset(&scan_ctx.list, 0, sizeof(SenselDeviceList));
+
+  for(i = 0; i < job.num_candidates && num_devices < SENSEL_MAX_DEVICES; i++)
+  {
+    if(!candidates[i].found)
+    {
+      all_found = false;
+      continue;
+    }
+
+    scan_ctx.list.devices[num_devices]     = candidates[i].devid;
+    scan_ctx.list.devices[num_devices].idx = num_devices;
+    scan_ctx.list.num_devices = ++num_devices;
+  }
+
+  // Only reuse the result if no supported device failed to answer, otherwise it is worth retrying next time
+  scan_ctx.cache_valid = from_sysfs && all_found;
+  scan_ctx.signature   = signature;
+
+  scan_ctx.scanned = true;
+  memcpy(list, &scan_ctx.list, sizeof(SenselDeviceList));
+
+  return num_devices;
+}
+
+unsigned char senselSerialScan(SenselDeviceList *list)
+{
+  unsigned char num_devices;
+
+  pthread_mutex_lock(&scan_ctx.lock);
+  num_devices = _senselSerialScanLocked(list);
+  pthread_mutex_unlock(&scan_ctx.lock);
+
   return num_devices;
 }
 
 void senselSerialClose(SenselSerialHandle *data)
 {
-  if(data->serial_fd != -1)
+  if(data->transport)
   {
-    close(data->serial_fd);
-    data->serial_fd = -1;
+    _senselSerialUnregisterHandle(data);
+    data->transport->close(data);
+    data->transport = NULL;
+
+    if(data->wake_fd != -1)
+    {
+      close(data->wake_fd);
+      data->wake_fd = -1;
+    }
+  }
+
+  if(data->rx_buffer)
+  {
+    free(data->rx_buffer);
+    data->rx_buffer = NULL;
   }
+  data->rx_capacity = 0;
+  data->rx_head     = 0;
+  data->rx_count    = 0;
 }
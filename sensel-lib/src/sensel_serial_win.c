@@ -26,6 +26,7 @@
 
 #include <windows.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <tchar.h>
 #include <setupapi.h>
 #include <devpkey.h>
@@ -36,8 +37,15 @@
 
 #define SENSEL_COM_PORT_PREFIX "\\\\.\\"
 
-unsigned char devices_scanned = false;
-SenselDeviceList devlist;
+// Result of the last scan, shared by every handle. The lock is held for the whole scan.
+typedef struct
+{
+  SRWLOCK           lock;
+  unsigned char     scanned;      // A scan has completed, list can be used to open devices
+  SenselDeviceList  list;         // Devices found by the last scan
+} SenselScanContext;
+
+static SenselScanContext scan_ctx = { SRWLOCK_INIT };
 
 static
 unsigned char senselSerialOpen2(SenselSerialHandle *data, char* com_port)
@@ -68,6 +76,9 @@ unsigned char senselSerialOpen2(SenselSerialHandle *data, char* com_port)
     printf ("CreateFile failed with error %d.\n", GetLastError());
     return false;
   }
+  data->rx_time_us  = 0;
+  data->rx_bytes    = 0;
+  data->rx_timeouts = 0;
 
   // Build on the current configuration, and skip setting the size
   // of the input and output buffers with SetupComm.
@@ -118,6 +129,9 @@ unsigned char senselSerialOpen2(SenselSerialHandle *data, char* com_port)
     printf("SetCommTimeouts failed.");
   }
 
+  data->timeout_ms      = timeouts.ReadTotalTimeoutConstant;
+  data->byte_timeout_ms = timeouts.ReadIntervalTimeout;
+
   printf("Serial port %s successfully connected.\n", com_port);
 
   // Flush out any characters that might be in the serial receive buffer
@@ -192,7 +206,8 @@ static unsigned char ComPortNames(SenselSerialHandle *data)
   return false;
 }
 
-unsigned char senselSerialScan(SenselDeviceList *list)
+// Called with scan_ctx.lock held
+static unsigned char _senselSerialScanLocked(SenselDeviceList *list)
 {
   unsigned int        index;
   unsigned int        devtypeidx;
@@ -205,14 +220,15 @@ unsigned char senselSerialScan(SenselDeviceList *list)
   unsigned char       num_devices = 0;
 
   memset(list, 0, sizeof(SenselDeviceList));
+  memset(&scan_ctx.list, 0, sizeof(SenselDeviceList));
   // List all connected USB devices
   hDevInfo = SetupDiGetClassDevs(NULL, TEXT("USB"), NULL, DIGCF_PRESENT | DIGCF_ALLCLASSES);
   for (index = 0; ; index++)
   {
     DeviceInfoData.cbSize = sizeof(DeviceInfoData);
     if (!SetupDiEnumDeviceInfo(hDevInfo, index, &DeviceInfoData)) {
-      devices_scanned = true;
-      memcpy(list, &devlist, sizeof(SenselDeviceList));
+      scan_ctx.scanned = true;
+      memcpy(list, &scan_ctx.list, sizeof(SenselDeviceList));
       return num_devices;
     }
 
@@ -240,7 +256,7 @@ unsigned char senselSerialScan(SenselDeviceList *list)
           found_sensor = senselSerialOpen2(&serial, com);
           if (found_sensor)
           {
-            SenselDeviceID *devid = &devlist.devices[num_devices];
+            SenselDeviceID *devid = &scan_ctx.list.devices[num_devices];
             unsigned int num_chars;
 
             status = _senselReadRegVS(NULL, &serial, SENSEL_REG_DEVICE_SERIAL_NUMBER, sizeof(devid->serial_num),
@@ -256,7 +272,7 @@ unsigned char senselSerialScan(SenselDeviceList *list)
             devid->idx = num_devices;
             devid->serial_num[num_chars] = 0;
             strncpy((char*)devid->com_port, com, sizeof(devid->com_port));
-            devlist.num_devices = ++num_devices;
+            scan_ctx.list.num_devices = ++num_devices;
           }
           senselSerialClose(&serial);
           if (num_devices == SENSEL_MAX_DEVICES)
@@ -269,6 +285,17 @@ unsigned char senselSerialScan(SenselDeviceList *list)
   return num_devices;
 }
 
+unsigned char senselSerialScan(SenselDeviceList *list)
+{
+  unsigned char num_devices;
+
+  AcquireSRWLockExclusive(&scan_ctx.lock);
+  num_devices = _senselSerialScanLocked(list);
+  ReleaseSRWLockExclusive(&scan_ctx.lock);
+
+  return num_devices;
+}
+
 unsigned char senselSerialOpen(SenselSerialHandle *data, char* com_port)
 {
   if(com_port != NULL)
@@ -278,6 +305,17 @@ unsigned char senselSerialOpen(SenselSerialHandle *data, char* com_port)
   return ComPortNames(data);
 }
 
+// Only COM ports are available on Windows
+unsigned char senselSerialOpenTransport(SenselSerialHandle *data, SenselTransportType type, char* address)
+{
+  if(type != SENSEL_TRANSPORT_TTY || address == NULL)
+  {
+    printf("Transport %d is not supported on Windows\n", (int)type);
+    return false;
+  }
+  return senselSerialOpen2(data, address);
+}
+
 void senselSerialFlushInput(SenselSerialHandle *data)
 {
   int           bytes_read = 0;
@@ -298,56 +336,92 @@ void senselSerialFlushInput(SenselSerialHandle *data)
 
 unsigned char senselSerialOpenDeviceByID(SenselSerialHandle *data, unsigned char idx)
 {
-  int i;
+  char  com[sizeof(scan_ctx.list.devices[0].com_port)];
+  int   i;
+
+  com[0] = 0;
 
-  if (!devices_scanned)
+  AcquireSRWLockExclusive(&scan_ctx.lock);
+  if (!scan_ctx.scanned)
   {
+    ReleaseSRWLockExclusive(&scan_ctx.lock);
     printf("senselSerialOpenDeviceByID. Need to call senselGetDeviceList first\n");
     return false;
   }
 
-  for (i = 0; i < devlist.num_devices; i++)
+  for (i = 0; i < scan_ctx.list.num_devices; i++)
   {
-    if (devlist.devices[i].idx == idx)
-      return senselSerialOpen2(data, (char*)devlist.devices[i].com_port);
+    if (scan_ctx.list.devices[i].idx == idx)
+    {
+      strcpy(com, (char*)scan_ctx.list.devices[i].com_port);
+      break;
+    }
   }
-  return false;
+  ReleaseSRWLockExclusive(&scan_ctx.lock);
+
+  if (!com[0])
+    return false;
+  return senselSerialOpen2(data, com);
 }
 
 unsigned char senselSerialOpenDeviceBySerialNum(SenselSerialHandle *data, char *serial_num)
 {
-  int i;
+  char  com[sizeof(scan_ctx.list.devices[0].com_port)];
+  int   i;
 
-  if (!devices_scanned)
+  com[0] = 0;
+
+  AcquireSRWLockExclusive(&scan_ctx.lock);
+  if (!scan_ctx.scanned)
   {
+    ReleaseSRWLockExclusive(&scan_ctx.lock);
     printf("senselSerialOpenDeviceBySerialNum. Need to call senselGetDeviceList first\n");
     return false;
   }
 
-  for (i = 0; i < devlist.num_devices; i++)
+  for (i = 0; i < scan_ctx.list.num_devices; i++)
   {
-    if (!strcmp((char *)serial_num, (char *)devlist.devices[i].serial_num))
-      return senselSerialOpen2(data, (char*)devlist.devices[i].com_port);
+    if (!strcmp((char *)serial_num, (char *)scan_ctx.list.devices[i].serial_num))
+    {
+      strcpy(com, (char*)scan_ctx.list.devices[i].com_port);
+      break;
+    }
   }
-  return false;
+  ReleaseSRWLockExclusive(&scan_ctx.lock);
+
+  if (!com[0])
+    return false;
+  return senselSerialOpen2(data, com);
 }
 
 unsigned char senselSerialOpenDeviceByComPort(SenselSerialHandle *data, char *com_port)
 {
-  int i;
+  char  com[sizeof(scan_ctx.list.devices[0].com_port)];
+  int   i;
 
-  if (!devices_scanned)
+  com[0] = 0;
+
+  AcquireSRWLockExclusive(&scan_ctx.lock);
+  if (!scan_ctx.scanned)
   {
+    ReleaseSRWLockExclusive(&scan_ctx.lock);
     printf("senselSerialOpenByComPort. Need to call senselGetDeviceList first\n");
     return false;
   }
 
-  for (i = 0; i < devlist.num_devices; i++)
+  for (i = 0; i < scan_ctx.list.num_devices; i++)
   {
-    if (!strcmp((char*)com_port, (char*)devlist.devices[i].com_port))
-      return senselSerialOpen2(data, (char*)devlist.devices[i].com_port);
+    if (!strcmp((char*)com_port, (char*)scan_ctx.list.devices[i].com_port))
+    {
+      strcpy(com, (char*)scan_ctx.list.devices[i].com_port);
+      break;
+    }
   }
-  return false;
+  ReleaseSRWLockExclusive(&scan_ctx.lock);
+
+  if (!com[0])
+    return false;
+  return senselSerialOpen2(data, com);
 }
 
 unsigned char senselSerialWrite(SenselSerialHandle *data, unsigned char* buf, int bufLen)
@@ -370,6 +444,40 @@ unsigned char senselSerialWrite(SenselSerialHandle *data, unsigned char* buf, in
   return true;
 }
 
+// Coalesces the buffers so the whole command goes out in a single WriteFile
+unsigned char senselSerialWriteV(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
+{
+  unsigned char stack_buf[1024];
+  unsigned char *write_buf = stack_buf;
+  unsigned char ret;
+  int           total      = 0;
+  int           offset     = 0;
+  int           i;
+
+  for(i = 0; i < num_bufs; i++)
+    total += bufs[i].len;
+
+  if((size_t)total > sizeof(stack_buf))
+  {
+    write_buf = (unsigned char*)malloc(total);
+    if(!write_buf)
+      return false;
+  }
+
+  for(i = 0; i < num_bufs; i++)
+  {
+    memcpy(write_buf + offset, bufs[i].buf, bufs[i].len);
+    offset += bufs[i].len;
+  }
+
+  ret = senselSerialWrite(data, write_buf, total);
+
+  if(write_buf != stack_buf)
+    free(write_buf);
+
+  return ret;
+}
+
 // Reads as many bytes as available, up to bufLen, returns number of bytes read or -1 on error
 int senselSerialReadAvailable(SenselSerialHandle *data, unsigned char* buf, int bufLen)
 {
@@ -382,9 +490,28 @@ int senselSerialReadAvailable(SenselSerialHandle *data, unsigned char* buf, int
     return -1;
   }
 
+  if (dwBytesRead > 0)
+  {
+    data->rx_bytes  += dwBytesRead;
+    data->rx_time_us = senselSerialGetTimeUS();
+  }
+
   return dwBytesRead;
 }
 
+long long senselSerialGetTimeUS(void)
+{
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER        counter;
+
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+
+  return (counter.QuadPart / frequency.QuadPart) * 1000000LL +
+         (counter.QuadPart % frequency.QuadPart) * 1000000LL / frequency.QuadPart;
+}
+
 // Reads a requested number of bytes, returns true on success, false on failure
 unsigned char senselSerialReadBytes(SenselSerialHandle *data, unsigned char* buf, int bufLen)
 {
@@ -403,6 +530,7 @@ unsigned char senselSerialReadBytes(SenselSerialHandle *data, unsigned char* buf
 
     if(attempts >= max_attempts)
     {
+      data->rx_timeouts++;
       return false;
     }
   }
@@ -426,6 +554,69 @@ int senselSerialGetAvailable(SenselSerialHandle *data)
   return comStatStruct.cbInQue;
 }
 
+unsigned char senselSerialIsDisconnected(SenselSerialHandle *data)
+{
+  return data->disconnected;
+}
+
+void senselSerialSetDisconnected(SenselSerialHandle *data)
+{
+  data->disconnected = true;
+}
+
+int senselSerialWait(SenselSerialHandle *data, int timeout_ms)
+{
+  long long deadline_us = senselSerialGetTimeUS() + (long long)timeout_ms * 1000LL;
+
+  // The port is opened without overlapped I/O, so there is no event to block on. Checking every
+  // millisecond keeps the latency low without spinning.
+  while(senselSerialGetAvailable(data) <= 0)
+  {
+    if(data->disconnected)
+      return -1;
+    if(timeout_ms >= 0 && senselSerialGetTimeUS() >= deadline_us)
+      return 0;
+    Sleep(1);
+  }
+
+  return 1;
+}
+
+void senselSerialSetTimeouts(SenselSerialHandle *data, unsigned int timeout_ms, unsigned int byte_timeout_ms)
+{
+  COMMTIMEOUTS timeouts;
+
+  GetCommTimeouts(data->serial_handle, &timeouts);
+
+  if(timeout_ms == 0)
+  {
+    // This combination makes ReadFile return immediately with whatever has been received
+    timeouts.ReadIntervalTimeout        = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant   = 0;
+    timeouts.ReadTotalTimeoutMultiplier = 0;
+  }
+  else
+  {
+    timeouts.ReadIntervalTimeout        = byte_timeout_ms;
+    timeouts.ReadTotalTimeoutConstant   = timeout_ms;
+    timeouts.ReadTotalTimeoutMultiplier = 0;
+  }
+
+  if(!SetCommTimeouts(data->serial_handle, &timeouts))
+  {
+    printf("SetCommTimeouts failed.");
+    return;
+  }
+
+  data->timeout_ms      = timeout_ms;
+  data->byte_timeout_ms = byte_timeout_ms;
+}
+
+// The comm timeouts are applied by ReadFile itself, so there is no deadline to start
+void senselSerialStartTimeout(SenselSerialHandle *data)
+{
+}
+
 void senselSerialClose(SenselSerialHandle *data)
 {
   if(data->serial_handle != INVALID_HANDLE_VALUE)
@@ -0,0 +1,75 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+
+#ifndef __SENSEL_TRANSPORT_H__
+#define __SENSEL_TRANSPORT_H__
+
+#include "sensel_serial.h"
+
+// Most buffers a single write call takes
+#define SENSEL_SERIAL_MAX_WRITE_BUFFERS 8
+
+// Byte stream backend used by the POSIX serial layer. Buffering, deadlines
+// and the register protocol live above this and are shared by every backend.
+//
+// read/write return the number of bytes transferred, 0 if the call would
+// block and -1 on error or when the link was closed.
+// wait blocks until the link is readable (or writable) and returns >0 when
+// ready, 0 on timeout and -1 on error. A negative timeout waits forever.
+typedef struct sensel_transport_s
+{
+  const char    *name;
+  unsigned char (*open)     (SenselSerialHandle *data, const char *address);
+  int           (*read)     (SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs);
+  int           (*write)    (SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs);
+  int           (*wait)     (SenselSerialHandle *data, unsigned char for_write, long long timeout_us);
+  int           (*available)(SenselSerialHandle *data);
+  void          (*flush)    (SenselSerialHandle *data); // Discards input already received by the backend
+  void          (*close)    (SenselSerialHandle *data);
+} SenselTransport;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const SenselTransport senselTransportTTY;
+extern const SenselTransport senselTransportUnixSocket;
+extern const SenselTransport senselTransportMemoryPipe;
+
+const SenselTransport *senselTransportGet(SenselTransportType type);
+
+// Helpers shared by transports built on a file descriptor in data->serial_fd
+int  senselTransportFdRead      (SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs);
+int  senselTransportFdWrite     (SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs);
+int  senselTransportFdWait      (SenselSerialHandle *data, unsigned char for_write, long long timeout_us);
+int  senselTransportFdAvailable (SenselSerialHandle *data);
+void senselTransportFdFlush     (SenselSerialHandle *data);
+void senselTransportFdClose     (SenselSerialHandle *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SENSEL_TRANSPORT_H__
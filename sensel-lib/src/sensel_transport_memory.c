@@ -0,0 +1,413 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+
+// sensel_transport_memory.c: in-process memory pipe transport. The device end of a pipe
+// is driven through the senselMemoryPipe* API, e.g. by a simulator in the same process.
+
+#define _DEFAULT_SOURCE
+
+#include "sensel.h"
+#include "sensel_device.h"
+#include "sensel_serial.h"
+#include "sensel_transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define SENSEL_MEMORY_PIPE_INITIAL_CAPACITY 4096
+#define SENSEL_MEMORY_PIPE_NAME_LEN         64
+
+typedef struct
+{
+  unsigned char *buf;
+  unsigned int  capacity;
+  unsigned int  start;    // Offset of the first unread byte
+  unsigned int  count;    // Number of unread bytes
+} SenselMemoryQueue;
+
+typedef struct sensel_memory_pipe_s
+{
+  char                        name[SENSEL_MEMORY_PIPE_NAME_LEN];
+  pthread_mutex_t             lock;
+  pthread_cond_t              to_host_cond;     // Signaled when the device end writes
+  pthread_cond_t              to_device_cond;   // Signaled when the host end writes
+  SenselMemoryQueue           to_host;          // Bytes written by the device end
+  SenselMemoryQueue           to_device;        // Bytes written by the host end
+  unsigned char               connected;        // A handle has the host end open
+  unsigned char               destroyed;        // The device end is gone, freed when the host closes
+  struct sensel_memory_pipe_s *next;
+} SenselMemoryPipe;
+
+static pthread_mutex_t  registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static SenselMemoryPipe *registry     = NULL;
+
+static unsigned char _senselMemoryQueuePush(SenselMemoryQueue *queue, const unsigned char *buf, unsigned int len)
+{
+  if(queue->start + queue->count + len > queue->capacity)
+  {
+    // Move unread bytes to the front first, grow only if that is not enough
+    if(queue->count > 0)
+      memmove(queue->buf, queue->buf + queue->start, queue->count);
+    queue->start = 0;
+
+    if(queue->count + len > queue->capacity)
+    {
+      unsigned int  capacity = queue->capacity ? queue->capacity : SENSEL_MEMORY_PIPE_INITIAL_CAPACITY;
+      unsigned char *new_buf;
+
+      while(capacity < queue->count + len)
+        capacity *= 2;
+
+      new_buf = (unsigned char*)realloc(queue->buf, capacity);
+      if(!new_buf)
+        return 0;
+
+      queue->buf      = new_buf;
+      queue->capacity = capacity;
+    }
+  }
+
+  memcpy(queue->buf + queue->start + queue->count, buf, len);
+  queue->count += len;
+  return 1;
+}
+
+static unsigned int _senselMemoryQueuePop(SenselMemoryQueue *queue, unsigned char *buf, unsigned int len)
+{
+  if(len > queue->count)
+    len = queue->count;
+
+  memcpy(buf, queue->buf + queue->start, len);
+  queue->start += len;
+  queue->count -= len;
+
+  if(queue->count == 0)
+    queue->start = 0;
+
+  return len;
+}
+
+// Waits on cond until the queue has data, the pipe is torn down or timeout_us elapses. Called with the lock held.
+static void _senselMemoryPipeWait(SenselMemoryPipe *pipe, pthread_cond_t *cond, SenselMemoryQueue *queue, long long timeout_us)
+{
+  struct timespec abstime;
+
+  if(timeout_us < 0)
+  {
+    while(queue->count == 0 && !pipe->destroyed)
+      pthread_cond_wait(cond, &pipe->lock);
+    return;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &abstime);
+  abstime.tv_sec  += (time_t)(timeout_us / 1000000LL);
+  abstime.tv_nsec += (long)(timeout_us % 1000000LL) * 1000L;
+  if(abstime.tv_nsec >= 1000000000L)
+  {
+    abstime.tv_sec++;
+    abstime.tv_nsec -= 1000000000L;
+  }
+
+  while(queue->count == 0 && !pipe->destroyed)
+  {
+    if(pthread_cond_timedwait(cond, &pipe->lock, &abstime) != 0)
+      break;
+  }
+}
+
+static void _senselMemoryPipeFree(SenselMemoryPipe *pipe)
+{
+  pthread_cond_destroy(&pipe->to_host_cond);
+  pthread_cond_destroy(&pipe->to_device_cond);
+  pthread_mutex_destroy(&pipe->lock);
+  free(pipe->to_host.buf);
+  free(pipe->to_device.buf);
+  free(pipe);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Host end, used through the transport vtable
+
+static unsigned char _senselTransportMemoryOpen(SenselSerialHandle *data, const char *address)
+{
+  SenselMemoryPipe *pipe;
+
+  pthread_mutex_lock(&registry_lock);
+  for(pipe = registry; pipe; pipe = pipe->next)
+  {
+    if(strcmp(pipe->name, address) == 0)
+      break;
+  }
+
+  if(pipe)
+  {
+    pthread_mutex_lock(&pipe->lock);
+    if(pipe->connected)
+    {
+      printf("Memory pipe %s is already open\n", address);
+      pthread_mutex_unlock(&pipe->lock);
+      pipe = NULL;
+    }
+    else
+    {
+      pipe->connected = 1;
+      pthread_mutex_unlock(&pipe->lock);
+    }
+  }
+  pthread_mutex_unlock(&registry_lock);
+
+  if(!pipe)
+    return 0;
+
+  data->transport_ctx = pipe;
+  return 1;
+}
+
+static int _senselTransportMemoryRead(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
+{
+  SenselMemoryPipe  *pipe  = (SenselMemoryPipe *)data->transport_ctx;
+  int               total  = 0;
+  int               i;
+
+  pthread_mutex_lock(&pipe->lock);
+  if(pipe->to_host.count == 0 && pipe->destroyed)
+  {
+    pthread_mutex_unlock(&pipe->lock);
+    return -1;
+  }
+  for(i = 0; i < num_bufs; i++)
+    total += _senselMemoryQueuePop(&pipe->to_host, bufs[i].buf, bufs[i].len);
+  pthread_mutex_unlock(&pipe->lock);
+
+  return total;
+}
+
+static int _senselTransportMemoryWrite(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
+{
+  SenselMemoryPipe  *pipe  = (SenselMemoryPipe *)data->transport_ctx;
+  int               total  = 0;
+  int               i;
+
+  pthread_mutex_lock(&pipe->lock);
+  if(pipe->destroyed)
+  {
+    pthread_mutex_unlock(&pipe->lock);
+    return -1;
+  }
+  for(i = 0; i < num_bufs; i++)
+  {
+    if(!_senselMemoryQueuePush(&pipe->to_device, bufs[i].buf, bufs[i].len))
+      break;
+    total += bufs[i].len;
+  }
+  pthread_cond_signal(&pipe->to_device_cond);
+  pthread_mutex_unlock(&pipe->lock);
+
+  return (total == 0) ? -1 : total;
+}
+
+static int _senselTransportMemoryWait(SenselSerialHandle *data, unsigned char for_write, long long timeout_us)
+{
+  SenselMemoryPipe  *pipe = (SenselMemoryPipe *)data->transport_ctx;
+  int               ret;
+
+  // The queues grow on demand so the host end is always writable
+  if(for_write)
+    return 1;
+
+  pthread_mutex_lock(&pipe->lock);
+  _senselMemoryPipeWait(pipe, &pipe->to_host_cond, &pipe->to_host, timeout_us);
+  ret = (pipe->to_host.count > 0 || pipe->destroyed) ? 1 : 0;
+  pthread_mutex_unlock(&pipe->lock);
+
+  return ret;
+}
+
+static int _senselTransportMemoryAvailable(SenselSerialHandle *data)
+{
+  SenselMemoryPipe  *pipe = (SenselMemoryPipe *)data->transport_ctx;
+  int               count;
+
+  pthread_mutex_lock(&pipe->lock);
+  count = pipe->to_host.count;
+  pthread_mutex_unlock(&pipe->lock);
+
+  return count;
+}
+
+static void _senselTransportMemoryFlush(SenselSerialHandle *data)
+{
+  SenselMemoryPipe *pipe = (SenselMemoryPipe *)data->transport_ctx;
+
+  pthread_mutex_lock(&pipe->lock);
+  pipe->to_host.start = 0;
+  pipe->to_host.count = 0;
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+static void _senselTransportMemoryClose(SenselSerialHandle *data)
+{
+  SenselMemoryPipe  *pipe = (SenselMemoryPipe *)data->transport_ctx;
+  unsigned char     destroyed;
+
+  if(!pipe)
+    return;
+
+  pthread_mutex_lock(&pipe->lock);
+  pipe->connected = 0;
+  destroyed = pipe->destroyed;
+  pthread_mutex_unlock(&pipe->lock);
+
+  // The device end was destroyed while we were attached, we hold the last reference
+  if(destroyed)
+    _senselMemoryPipeFree(pipe);
+
+  data->transport_ctx = NULL;
+}
+
+const SenselTransport senselTransportMemoryPipe =
+{
+  "memory",
+  _senselTransportMemoryOpen,
+  _senselTransportMemoryRead,
+  _senselTransportMemoryWrite,
+  _senselTransportMemoryWait,
+  _senselTransportMemoryAvailable,
+  _senselTransportMemoryFlush,
+  _senselTransportMemoryClose,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Device end
+
+SENSEL_API
+SenselStatus WINAPI senselMemoryPipeCreate(const char *name, SENSEL_MEMORY_PIPE *pipe)
+{
+  SenselMemoryPipe *p;
+  SenselMemoryPipe *it;
+
+  if(!name || !pipe || strlen(name) >= SENSEL_MEMORY_PIPE_NAME_LEN)
+    return SENSEL_ERROR;
+
+  *pipe = NULL;
+
+  p = (SenselMemoryPipe *)calloc(1, sizeof(SenselMemoryPipe));
+  if(!p)
+    return SENSEL_ERROR;
+
+  strcpy(p->name, name);
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->to_host_cond, NULL);
+  pthread_cond_init(&p->to_device_cond, NULL);
+
+  pthread_mutex_lock(&registry_lock);
+  for(it = registry; it; it = it->next)
+  {
+    if(strcmp(it->name, name) == 0)
+    {
+      pthread_mutex_unlock(&registry_lock);
+      printf("Memory pipe %s already exists\n", name);
+      _senselMemoryPipeFree(p);
+      return SENSEL_ERROR;
+    }
+  }
+  p->next  = registry;
+  registry = p;
+  pthread_mutex_unlock(&registry_lock);
+
+  *pipe = p;
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselMemoryPipeDestroy(SENSEL_MEMORY_PIPE pipe)
+{
+  SenselMemoryPipe  *p = (SenselMemoryPipe *)pipe;
+  SenselMemoryPipe  **it;
+  unsigned char     connected;
+
+  if(!p)
+    return SENSEL_ERROR;
+
+  pthread_mutex_lock(&registry_lock);
+  for(it = &registry; *it; it = &(*it)->next)
+  {
+    if(*it == p)
+    {
+      *it = p->next;
+      break;
+    }
+  }
+
+  pthread_mutex_lock(&p->lock);
+  p->destroyed = 1;
+  connected = p->connected;
+  // Wake up the host end so that it sees the pipe closing
+  pthread_cond_broadcast(&p->to_host_cond);
+  pthread_cond_broadcast(&p->to_device_cond);
+  pthread_mutex_unlock(&p->lock);
+  pthread_mutex_unlock(&registry_lock);
+
+  if(!connected)
+    _senselMemoryPipeFree(p);
+
+  return SENSEL_OK;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselMemoryPipeWrite(SENSEL_MEMORY_PIPE pipe, const unsigned char *buf, unsigned int len)
+{
+  SenselMemoryPipe  *p = (SenselMemoryPipe *)pipe;
+  unsigned char     ok;
+
+  if(!p || (!buf && len > 0))
+    return SENSEL_ERROR;
+
+  pthread_mutex_lock(&p->lock);
+  ok = _senselMemoryQueuePush(&p->to_host, buf, len);
+  pthread_cond_signal(&p->to_host_cond);
+  pthread_mutex_unlock(&p->lock);
+
+  return ok ? SENSEL_OK : SENSEL_ERROR;
+}
+
+SENSEL_API
+SenselStatus WINAPI senselMemoryPipeRead(SENSEL_MEMORY_PIPE pipe, unsigned char *buf, unsigned int buf_size,
+                                         unsigned int *read_size, int timeout_ms)
+{
+  SenselMemoryPipe *p = (SenselMemoryPipe *)pipe;
+
+  if(!p || !buf || !read_size)
+    return SENSEL_ERROR;
+
+  pthread_mutex_lock(&p->lock);
+  _senselMemoryPipeWait(p, &p->to_device_cond, &p->to_device, (timeout_ms < 0) ? -1 : (long long)timeout_ms * 1000LL);
+  *read_size = _senselMemoryQueuePop(&p->to_device, buf, buf_size);
+  pthread_mutex_unlock(&p->lock);
+
+  return SENSEL_OK;
+}
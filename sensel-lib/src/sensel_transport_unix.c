@@ -0,0 +1,141 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// sensel_transport_unix.c: Unix-domain stream socket transport
+
+#define _DEFAULT_SOURCE
+
+#include "sensel.h"
+#include "sensel_device.h"
+#include "sensel_serial.h"
+#include "sensel_transport.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+// Writing to a socket whose peer went away must fail with EPIPE rather than raise SIGPIPE.
+// Linux takes a flag on each send, macOS a socket option set once at open.
+#ifdef MSG_NOSIGNAL
+#define SENSEL_UNIX_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SENSEL_UNIX_SEND_FLAGS 0
+#endif
+
+// Connects to a stream socket at the given path. The peer speaks the same
+// byte protocol as the device, e.g. a capture host relaying a pad.
+static unsigned char _senselTransportUnixOpen(SenselSerialHandle *data, const char *address)
+{
+  struct sockaddr_un addr;
+
+  if(strlen(address) >= sizeof(addr.sun_path))
+  {
+    printf("Socket path too long: %s\n", address);
+    return 0;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, address);
+
+  data->serial_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if(data->serial_fd == -1)
+  {
+    return 0;
+  }
+
+  if(connect(data->serial_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+  {
+    senselTransportFdClose(data);
+    return 0;
+  }
+
+#ifdef SO_NOSIGPIPE
+  {
+    int on = 1;
+    setsockopt(data->serial_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+  }
+#endif
+
+  fcntl(data->serial_fd, F_SETFL, fcntl(data->serial_fd, F_GETFL) | O_NONBLOCK);
+
+  return 1;
+}
+
+// Same as senselTransportFdWrite, but a capture host that has gone away shows up as a disconnect
+// instead of a SIGPIPE that would kill the application
+static int _senselTransportUnixWrite(SenselSerialHandle *data, SenselSerialBuffer *bufs, int num_bufs)
+{
+  struct iovec  iov[SENSEL_SERIAL_MAX_WRITE_BUFFERS];
+  struct msghdr msg;
+  int           i;
+  ssize_t       ret;
+
+  if(num_bufs > SENSEL_SERIAL_MAX_WRITE_BUFFERS)
+    return -1;
+
+  for(i = 0; i < num_bufs; i++)
+  {
+    iov[i].iov_base = bufs[i].buf;
+    iov[i].iov_len  = bufs[i].len;
+  }
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov    = iov;
+  msg.msg_iovlen = num_bufs;
+
+  ret = sendmsg(data->serial_fd, &msg, SENSEL_UNIX_SEND_FLAGS);
+
+  if(ret < 0)
+  {
+    if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      return 0;
+    if(errno == EPIPE || errno == ECONNRESET)
+      senselSerialSetDisconnected(data);
+    return -1;
+  }
+  return (int)ret;
+}
+
+// Nothing sits between the socket and the receive ring, draining the socket is enough
+static void _senselTransportUnixFlush(SenselSerialHandle *data)
+{
+}
+
+const SenselTransport senselTransportUnixSocket =
+{
+  "unix",
+  _senselTransportUnixOpen,
+  senselTransportFdRead,
+  _senselTransportUnixWrite,
+  senselTransportFdWait,
+  senselTransportFdAvailable,
+  _senselTransportUnixFlush,
+  senselTransportFdClose,
+};
@@ -0,0 +1,92 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// Times the generic contact decoder against the mask-specialized one for each of the 16 contact masks.
+// Frames are synthetic, each carrying TEST_MAX_CONTACTS contacts with random field values.
+
+#include "sensel.c"
+#include "sensel_test_contacts.h"
+
+#define NUM_FRAMES  256
+#define NUM_PASSES  2000
+
+static unsigned char  frames[NUM_FRAMES][TEST_MAX_CONTACTS * 64];
+static SenselContact  contacts[TEST_MAX_CONTACTS];
+
+// Keeps the decoded contacts alive so the compiler can't drop the decoding
+static volatile float sink;
+
+// Decodes every frame NUM_PASSES times, with the generic decoder when decoder is NULL. Returns ns per frame.
+static double benchDecoder(SenselDevice *device, int mask, SenselContactDecoder decoder)
+{
+  long long start_us = senselSerialGetTimeUS();
+  long long elapsed_us;
+
+  for(int pass = 0; pass < NUM_PASSES; pass++)
+  {
+    for(int f = 0; f < NUM_FRAMES; f++)
+    {
+      if(decoder)
+        decoder(device, frames[f], contacts, TEST_MAX_CONTACTS);
+      else
+        referenceDecodeContacts(device, frames[f], mask, contacts, TEST_MAX_CONTACTS);
+      sink += contacts[f % TEST_MAX_CONTACTS].x_pos;
+    }
+  }
+
+  elapsed_us = senselSerialGetTimeUS() - start_us;
+  return (double)elapsed_us * 1000.0 / (double)(NUM_PASSES * NUM_FRAMES);
+}
+
+int main(void)
+{
+  static SenselDevice device;
+
+  srand(1);
+  testSetUnitShifts(&device, 8, 3, 4, 0);
+
+  printf("%d contacts per frame, %d frames x %d passes per mask\n", TEST_MAX_CONTACTS, NUM_FRAMES, NUM_PASSES);
+  printf("mask  bytes/frame  generic ns/frame  specialized ns/frame  speedup\n");
+
+  for(int mask = 0; mask < 16; mask++)
+  {
+    double generic_ns;
+    double specialized_ns;
+
+    for(int f = 0; f < NUM_FRAMES; f++)
+      testMakeContacts(frames[f], mask, TEST_MAX_CONTACTS);
+
+    // Warm up caches and branch predictors on both before timing
+    benchDecoder(&device, mask, NULL);
+    benchDecoder(&device, mask, _senselContactDecoders[mask]);
+
+    generic_ns     = benchDecoder(&device, mask, NULL);
+    specialized_ns = benchDecoder(&device, mask, _senselContactDecoders[mask]);
+
+    printf("%4d  %11d  %16.1f  %20.1f  %6.2fx\n", mask, TEST_MAX_CONTACTS * _senselContactSendSize(mask),
+           generic_ns, specialized_ns, specialized_ns > 0.0 ? generic_ns / specialized_ns : 0.0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// Shared by the contact decoder test and benchmark, which include sensel.c to reach its decoders
+
+#ifndef __SENSEL_TEST_CONTACTS_H__
+#define __SENSEL_TEST_CONTACTS_H__
+
+#define TEST_MAX_CONTACTS 16
+
+// Generic contact decoder, as senselGetFrame decoded contacts before the mask-specialized decoders.
+// The specialized decoders are checked and measured against it.
+static unsigned char *referenceDecodeContacts(const SenselDevice *device, unsigned char *data_buf, int bit_mask,
+                                              SenselContact *contacts, int num_contacts)
+{
+  for (int i = 0; i < num_contacts; i++) {
+    contact_raw_t prtcl_raw_contact;
+
+    memcpy(&prtcl_raw_contact, data_buf, CONTACT_DEFAULT_SEND_SIZE);
+    data_buf = data_buf + CONTACT_DEFAULT_SEND_SIZE;
+
+    contacts[i].content_bit_mask  = bit_mask;
+    contacts[i].id                = (unsigned char)prtcl_raw_contact.id;
+    contacts[i].state             = (unsigned int)prtcl_raw_contact.type;
+    contacts[i].x_pos             = (float)prtcl_raw_contact.x_pos / device->dims_value_scale;
+    contacts[i].y_pos             = (float)prtcl_raw_contact.y_pos / device->dims_value_scale;
+    contacts[i].total_force       = (float)prtcl_raw_contact.total_force / device->force_value_scale;
+    contacts[i].area              = (float)prtcl_raw_contact.area / device->area_value_scale;
+
+    if (bit_mask & CONTACT_MASK_ELLIPSE)
+    {
+      memcpy(&prtcl_raw_contact.orientation, data_buf, CONTACT_ELLIPSE_SEND_SIZE);
+      data_buf = data_buf + CONTACT_ELLIPSE_SEND_SIZE;
+
+      contacts[i].orientation = (float)prtcl_raw_contact.orientation / device->angle_value_scale;
+      contacts[i].major_axis  = (float)prtcl_raw_contact.major_axis / device->dims_value_scale;
+      contacts[i].minor_axis  = (float)prtcl_raw_contact.minor_axis / device->dims_value_scale;
+    }
+    if (bit_mask & CONTACT_MASK_DELTAS)
+    {
+      memcpy(&prtcl_raw_contact.delta_x, data_buf, CONTACT_DELTAS_SEND_SIZE);
+      data_buf = data_buf + CONTACT_DELTAS_SEND_SIZE;
+
+      contacts[i].delta_x     = (float)prtcl_raw_contact.delta_x / device->dims_value_scale;
+      contacts[i].delta_y     = (float)prtcl_raw_contact.delta_y / device->dims_value_scale;
+      contacts[i].delta_force = (float)prtcl_raw_contact.delta_force / device->force_value_scale;
+      contacts[i].delta_area  = (float)prtcl_raw_contact.delta_area / device->area_value_scale;
+    }
+    if (bit_mask & CONTACT_MASK_BOUNDING_BOX)
+    {
+      memcpy(&prtcl_raw_contact.min_x, data_buf, CONTACT_BOUNDING_BOX_SEND_SIZE);
+      data_buf = data_buf + CONTACT_BOUNDING_BOX_SEND_SIZE;
+
+      contacts[i].min_x = (float)prtcl_raw_contact.min_x / device->dims_value_scale;
+      contacts[i].min_y = (float)prtcl_raw_contact.min_y / device->dims_value_scale;
+      contacts[i].max_x = (float)prtcl_raw_contact.max_x / device->dims_value_scale;
+      contacts[i].max_y = (float)prtcl_raw_contact.max_y / device->dims_value_scale;
+    }
+    if (bit_mask & CONTACT_MASK_PEAK)
+    {
+      memcpy(&prtcl_raw_contact.peak_x, data_buf, CONTACT_PEAK_SEND_SIZE);
+      data_buf = data_buf + CONTACT_PEAK_SEND_SIZE;
+
+      contacts[i].peak_x      = (float)prtcl_raw_contact.peak_x / device->dims_value_scale;
+      contacts[i].peak_y      = (float)prtcl_raw_contact.peak_y / device->dims_value_scale;
+      contacts[i].peak_force  = (float)prtcl_raw_contact.peak_force / device->force_value_scale;
+    }
+  }
+  return data_buf;
+}
+
+// Sets the unit shifts of a device and the scales derived from them, as senselOpenDeviceByID does
+static void testSetUnitShifts(SenselDevice *device, int dims, int force, int angle, int area)
+{
+  device->unit_shift.dims  = dims;
+  device->unit_shift.force = force;
+  device->unit_shift.angle = angle;
+  device->unit_shift.area  = area;
+
+  device->dims_value_scale  = (float)(1 << dims);
+  device->force_value_scale = (float)(1 << force);
+  device->angle_value_scale = (float)(1 << angle);
+  device->area_value_scale  = (float)(1 << area);
+
+  device->dims_value_inv  = 1.0f / device->dims_value_scale;
+  device->force_value_inv = 1.0f / device->force_value_scale;
+  device->angle_value_inv = 1.0f / device->angle_value_scale;
+  device->area_value_inv  = 1.0f / device->area_value_scale;
+}
+
+// Writes num_contacts contacts with random field values, as the device sends them with bit_mask.
+// Returns the number of bytes written.
+static int testMakeContacts(unsigned char *buf, int bit_mask, int num_contacts)
+{
+  int size = num_contacts * _senselContactSendSize(bit_mask);
+
+  for(int i = 0; i < size; i++)
+    buf[i] = (unsigned char)rand();
+  return size;
+}
+
+#endif //__SENSEL_TEST_CONTACTS_H__
@@ -0,0 +1,452 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// Simulated Sensel device on the device end of a memory pipe (SENSEL_TRANSPORT_MEMORY_PIPE), or behind a
+// listening Unix socket (SENSEL_TRANSPORT_UNIX_SOCKET). It answers
+// register reads and writes, frame requests in SCAN_MODE_SYNC with or without scan buffers, and streams
+// frames in SCAN_MODE_ASYNC, whole or in pieces (see testDeviceSplitFrames). Contact i of a frame has id i and fixed field values, see testFrameIsIntact.
+
+#ifndef __SENSEL_TEST_DEVICE_H__
+#define __SENSEL_TEST_DEVICE_H__
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sensel.h"
+#include "sensel_register.h"
+#include "sensel_register_map.h"
+
+#define TEST_DEVICE_MAX_CONTACTS 16   // Default contact limit, see testDeviceSetContacts
+#define TEST_DEVICE_CONTACT_AREA 400
+#define TEST_DEVICE_SPLIT_SIZE   8    // Bytes of a split frame sent ahead of the rest, less than any frame
+
+typedef struct
+{
+  SENSEL_MEMORY_PIPE  pipe;
+  int                 listen_fd;            // Socket devices only, -1 otherwise
+  int                 conn_fd;              // Connection of the library to a socket device, -1 if none
+  char                path[108];            // Path the socket device listens on
+  pthread_t           thread;
+  int                 stop;                 // Set to end the device thread
+  unsigned int        frames_sent;          // Frames put on the wire
+  unsigned char       regs[256];
+  unsigned char       rolling_frame_counter;
+  unsigned int        timestamp;
+  unsigned int        seed;
+  int                 split_gap_us;         // Gap between the two pieces of a split frame, 0 sends frames whole
+  int                 fixed_contacts;       // Contacts in every frame, -1 for a random number up to the limit
+} TestDevice;
+
+static inline unsigned int testDeviceRand(TestDevice *device)
+{
+  device->seed = device->seed * 1103515245u + 12345u;
+  return device->seed >> 16;
+}
+
+static inline void testDeviceSend(TestDevice *device, const unsigned char *buf, int len)
+{
+  if(device->listen_fd == -1)
+  {
+    senselMemoryPipeWrite(device->pipe, buf, len);
+    return;
+  }
+
+  while(len > 0 && device->conn_fd != -1)
+  {
+    ssize_t sent = send(device->conn_fd, buf, len, MSG_NOSIGNAL);
+
+    if(sent <= 0)
+      break;
+    buf += sent;
+    len -= sent;
+  }
+}
+
+// Waits up to a millisecond for bytes from the library, returns how many were read into buf
+static inline unsigned int testDeviceReceive(TestDevice *device, unsigned char *buf, unsigned int buf_size)
+{
+  struct pollfd pfd;
+  unsigned int  got = 0;
+  ssize_t       ret;
+
+  if(device->listen_fd == -1)
+  {
+    senselMemoryPipeRead(device->pipe, buf, buf_size, &got, 1);
+    return got;
+  }
+
+  // One connection at a time, a new one is accepted once the library hangs up
+  pfd.fd      = (device->conn_fd == -1) ? device->listen_fd : device->conn_fd;
+  pfd.events  = POLLIN;
+  pfd.revents = 0;
+  if(poll(&pfd, 1, 1) <= 0)
+    return 0;
+
+  if(device->conn_fd == -1)
+  {
+    device->conn_fd = accept(device->listen_fd, NULL, NULL);
+    return 0;
+  }
+
+  ret = recv(device->conn_fd, buf, buf_size, 0);
+  if(ret <= 0)
+  {
+    close(device->conn_fd);
+    device->conn_fd = -1;
+    return 0;
+  }
+  return (unsigned int)ret;
+}
+
+// Sends one frame with the content the library asked for and a random number of contacts
+static inline void testDeviceSendFrame(TestDevice *device, unsigned char ack)
+{
+  unsigned char   out[16 + 255 * 38];
+  unsigned char   content       = device->regs[SENSEL_REG_FRAME_CONTENT_CONTROL] & (FRAME_CONTENT_CONTACTS_MASK | FRAME_CONTENT_ACCEL_MASK);
+  unsigned char   contacts_mask = device->regs[SENSEL_REG_CONTACTS_MASK] & 0x0F;
+  int             num_contacts  = device->fixed_contacts;
+  int             n             = 5;
+  unsigned short  payload_size;
+  unsigned char   checksum      = 0;
+  int             split_gap_us;
+  int             i;
+
+  if(num_contacts < 0)
+    num_contacts = testDeviceRand(device) % (device->regs[SENSEL_REG_CONTACTS_MAX_COUNT] + 1);
+
+  out[n++] = content;
+  out[n++] = device->rolling_frame_counter++;
+  memcpy(&out[n], &device->timestamp, 4);
+  n += 4;
+  device->timestamp += 8000;
+
+  if(content & FRAME_CONTENT_CONTACTS_MASK)
+  {
+    out[n++] = contacts_mask;
+    out[n++] = num_contacts;
+    for(i = 0; i < num_contacts; i++)
+    {
+      unsigned short fields[4] = {100 + i, 200 + i, 300, TEST_DEVICE_CONTACT_AREA};
+
+      out[n++] = i;                   // id
+      out[n++] = CONTACT_MOVE;        // state
+      memcpy(&out[n], fields, sizeof(fields));
+      n += sizeof(fields);
+      if(contacts_mask & CONTACT_MASK_ELLIPSE)      { memset(&out[n], 1, 6); n += 6; }
+      if(contacts_mask & CONTACT_MASK_DELTAS)       { memset(&out[n], 0, 8); n += 8; }
+      if(contacts_mask & CONTACT_MASK_BOUNDING_BOX) { memset(&out[n], 2, 8); n += 8; }
+      if(contacts_mask & CONTACT_MASK_PEAK)         { memset(&out[n], 3, 6); n += 6; }
+    }
+  }
+  if(content & FRAME_CONTENT_ACCEL_MASK)
+  {
+    short accel[3] = {1, -2, 3};
+
+    memcpy(&out[n], accel, sizeof(accel));
+    n += sizeof(accel);
+  }
+
+  payload_size = n - 5;
+  out[0] = ack;
+  out[1] = SENSEL_REG_SCAN_READ_FRAME;
+  out[2] = 0;
+  memcpy(&out[3], &payload_size, 2);
+  for(i = 5; i < n; i++)
+    checksum += out[i];
+  out[n++] = checksum;
+
+  split_gap_us = __atomic_load_n(&device->split_gap_us, __ATOMIC_RELAXED);
+  if(split_gap_us > 0)
+  {
+    // The header now, the rest once the host has had time to see a partial frame
+    struct timespec gap = {split_gap_us / 1000000, (split_gap_us % 1000000) * 1000L};
+
+    testDeviceSend(device, out, TEST_DEVICE_SPLIT_SIZE);
+    nanosleep(&gap, NULL);
+    testDeviceSend(device, out + TEST_DEVICE_SPLIT_SIZE, n - TEST_DEVICE_SPLIT_SIZE);
+  }
+  else
+  {
+    testDeviceSend(device, out, n);
+  }
+  __atomic_add_fetch(&device->frames_sent, 1, __ATOMIC_RELAXED);
+}
+
+// Handles the command at the start of in, returns the number of bytes it took or 0 if it is incomplete
+static inline int testDeviceCommand(TestDevice *device, unsigned char *in, int len, unsigned int *vs_left)
+{
+  unsigned char reg  = in[1];
+  unsigned char size = in[2];
+  unsigned char out[300];
+  int           i;
+
+  // Packet of a variable size write: size(2), data, checksum
+  if(*vs_left > 0)
+  {
+    unsigned short packet_size = in[0] | (in[1] << 8);
+    unsigned char  ack         = PT_WVS_ACK;
+
+    if(len < 2 + packet_size + 1)
+      return 0;
+    *vs_left -= (packet_size < *vs_left) ? packet_size : *vs_left;
+    testDeviceSend(device, &ack, 1);
+    return 2 + packet_size + 1;
+  }
+
+  if(in[0] & 0x80)
+  {
+    if(reg == SENSEL_REG_SCAN_READ_FRAME)
+    {
+      int num_frames = device->regs[SENSEL_REG_SCAN_BUFFER_CONTROL] ? 1 + testDeviceRand(device) % 4 : 1;
+
+      for(i = 0; i < num_frames; i++)
+        testDeviceSendFrame(device, PT_RVS_ACK);
+      if(device->regs[SENSEL_REG_SCAN_BUFFER_CONTROL])
+      {
+        unsigned char end = PT_BUFFERED_FRAME;
+        testDeviceSend(device, &end, 1);
+      }
+    }
+    else if(size == 0)
+    {
+      // Variable size read of an empty register
+      unsigned char response[6] = {PT_RVS_ACK, reg, 0, 0, 0, 0};
+      testDeviceSend(device, response, sizeof(response));
+    }
+    else
+    {
+      unsigned char checksum = 0;
+
+      out[0] = PT_READ_ACK;
+      out[1] = reg;
+      out[2] = size;
+      out[3] = 0;
+      for(i = 0; i < size; i++)
+      {
+        out[4 + i] = device->regs[(reg + i) & 0xFF];
+        checksum += out[4 + i];
+      }
+      out[4 + size] = checksum;
+      testDeviceSend(device, out, 4 + size + 1);
+    }
+    return 3;
+  }
+
+  if(size == 0)
+  {
+    // Header of a variable size write: the total size follows the command
+    unsigned char ack[2] = {PT_WRITE_ACK, reg};
+
+    if(len < 9)
+      return 0;
+    memcpy(vs_left, &in[4], 4);
+    testDeviceSend(device, ack, sizeof(ack));
+    return 9;
+  }
+
+  if(len < 3 + size + 1)
+    return 0;
+  memcpy(&device->regs[reg], &in[3], (reg + size <= 256) ? size : 256 - reg);
+  if(reg == SENSEL_REG_SOFT_RESET)
+    device->regs[SENSEL_REG_SCAN_ENABLED] = 0;
+  out[0] = PT_WRITE_ACK;
+  out[1] = reg;
+  testDeviceSend(device, out, 2);
+  return 3 + size + 1;
+}
+
+static inline void *testDeviceThread(void *arg)
+{
+  TestDevice    *device   = (TestDevice *)arg;
+  unsigned char in[4096];
+  int           len       = 0;
+  unsigned int  vs_left   = 0;
+
+  while(!__atomic_load_n(&device->stop, __ATOMIC_ACQUIRE))
+  {
+    if(device->regs[SENSEL_REG_SCAN_ENABLED] == SCAN_MODE_ASYNC)
+      testDeviceSendFrame(device, PT_ASYNC_DATA);
+
+    len += testDeviceReceive(device, in + len, sizeof(in) - len);
+
+    while(len >= 3)
+    {
+      int used = testDeviceCommand(device, in, len, &vs_left);
+
+      if(used == 0)
+        break;
+      memmove(in, in + used, len - used);
+      len -= used;
+    }
+  }
+  return NULL;
+}
+
+static inline TestDevice *testDeviceCreate(unsigned int seed)
+{
+  TestDevice *device = calloc(1, sizeof(TestDevice));
+
+  if(!device)
+    return NULL;
+
+  device->listen_fd      = -1;
+  device->conn_fd        = -1;
+  device->fixed_contacts = -1;
+  memcpy(device->regs, "S3NS31", 6);
+  device->regs[SENSEL_REG_FW_VERSION_PROTOCOL]   = 1;
+  device->regs[SENSEL_REG_FRAME_CONTENT_SUPPORTED] = 0x0F;
+  device->regs[SENSEL_REG_FRAME_CONTENT_CONTROL] = FRAME_CONTENT_CONTACTS_MASK;
+  device->regs[SENSEL_REG_CONTACTS_MAX_COUNT]    = TEST_DEVICE_MAX_CONTACTS;
+  device->regs[SENSEL_REG_SENSOR_NUM_COLS]       = 185;
+  device->regs[SENSEL_REG_SENSOR_NUM_ROWS]       = 105;
+  device->regs[SENSEL_REG_LED_COUNT]             = 16;
+  device->regs[SENSEL_REG_LED_BRIGHTNESS_SIZE]   = 1;
+  device->regs[SENSEL_REG_LED_BRIGHTNESS_MAX]    = 255;
+  device->regs[SENSEL_REG_UNIT_SHIFT_DIMS]       = 8;
+  device->regs[SENSEL_REG_UNIT_SHIFT_FORCE]      = 3;
+  device->regs[SENSEL_REG_UNIT_SHIFT_AREA]       = 0;
+  device->regs[SENSEL_REG_UNIT_SHIFT_ANGLE]      = 4;
+  device->seed = seed;
+  return device;
+}
+
+// Creates the pipe called name and starts answering on it
+static inline TestDevice *testDeviceStart(const char *name, unsigned int seed)
+{
+  TestDevice *device = testDeviceCreate(seed);
+
+  if(!device)
+    return NULL;
+
+  if(senselMemoryPipeCreate(name, &device->pipe) != SENSEL_OK)
+  {
+    free(device);
+    return NULL;
+  }
+  if(pthread_create(&device->thread, NULL, testDeviceThread, device) != 0)
+  {
+    senselMemoryPipeDestroy(device->pipe);
+    free(device);
+    return NULL;
+  }
+  return device;
+}
+
+// Listens on a Unix socket at path and answers the library once it connects
+static inline TestDevice *testDeviceStartSocket(const char *path, unsigned int seed)
+{
+  TestDevice          *device = testDeviceCreate(seed);
+  struct sockaddr_un  addr;
+
+  if(!device)
+    return NULL;
+  if(strlen(path) >= sizeof(addr.sun_path))
+  {
+    free(device);
+    return NULL;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  strcpy(device->path, path);
+  unlink(path);
+
+  device->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(device->listen_fd == -1 ||
+     bind(device->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+     listen(device->listen_fd, 1) == -1 ||
+     pthread_create(&device->thread, NULL, testDeviceThread, device) != 0)
+  {
+    if(device->listen_fd != -1)
+      close(device->listen_fd);
+    unlink(path);
+    free(device);
+    return NULL;
+  }
+  return device;
+}
+
+// Stops answering. A socket device hangs up on the library.
+static inline void testDeviceStop(TestDevice *device)
+{
+  __atomic_store_n(&device->stop, 1, __ATOMIC_RELEASE);
+  pthread_join(device->thread, NULL);
+  if(device->listen_fd == -1)
+  {
+    senselMemoryPipeDestroy(device->pipe);
+  }
+  else
+  {
+    if(device->conn_fd != -1)
+      close(device->conn_fd);
+    close(device->listen_fd);
+    unlink(device->path);
+  }
+  free(device);
+}
+
+// Makes the device send each frame in two pieces gap_us apart, or whole again with 0
+static inline void testDeviceSplitFrames(TestDevice *device, int gap_us)
+{
+  __atomic_store_n(&device->split_gap_us, gap_us, __ATOMIC_RELAXED);
+}
+
+// Sets the contact limit the device reports and the contacts it puts in each frame, -1 for a random number.
+// Must be called before a handle is opened on the device.
+static inline void testDeviceSetContacts(TestDevice *device, int max_contacts, int fixed_contacts)
+{
+  device->regs[SENSEL_REG_CONTACTS_MAX_COUNT] = max_contacts;
+  device->fixed_contacts                      = fixed_contacts;
+}
+
+static inline unsigned int testDeviceFramesSent(TestDevice *device)
+{
+  return __atomic_load_n(&device->frames_sent, __ATOMIC_RELAXED);
+}
+
+// Checks the contacts of a frame against what the simulated device sends
+static inline int testFrameIsIntact(const SenselFrameData *frame)
+{
+  int i;
+
+  if(!(frame->content_bit_mask & FRAME_CONTENT_CONTACTS_MASK))
+    return frame->n_contacts == 0;
+  if(frame->n_contacts > TEST_DEVICE_MAX_CONTACTS)
+    return 0;
+  for(i = 0; i < frame->n_contacts; i++)
+  {
+    if(frame->contacts[i].id != i || frame->contacts[i].area != (float)TEST_DEVICE_CONTACT_AREA)
+      return 0;
+  }
+  return 1;
+}
+
+#endif //__SENSEL_TEST_DEVICE_H__
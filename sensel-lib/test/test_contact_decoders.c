@@ -0,0 +1,95 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// Checks that each mask-specialized contact decoder gives bit for bit the contacts of the generic decoder
+
+#include "sensel.c"
+#include "sensel_test_contacts.h"
+
+#define NUM_ROUNDS 200
+
+// Unit shifts to decode with: those of current firmware, none at all, and large ones
+static const int unit_shifts[][4] =
+{
+  {8, 3, 4, 0},
+  {0, 0, 0, 0},
+  {12, 8, 6, 4},
+};
+
+int main(void)
+{
+  static SenselDevice device;
+  unsigned char       buf[TEST_MAX_CONTACTS * 64];
+  SenselContact       expected[TEST_MAX_CONTACTS];
+  SenselContact       decoded[TEST_MAX_CONTACTS];
+  int                 failures = 0;
+
+  srand(1);
+
+  for(int mask = 0; mask < 16; mask++)
+  {
+    int mask_failures = 0;
+
+    for(int s = 0; s < (int)(sizeof(unit_shifts) / sizeof(unit_shifts[0])); s++)
+    {
+      testSetUnitShifts(&device, unit_shifts[s][0], unit_shifts[s][1], unit_shifts[s][2], unit_shifts[s][3]);
+
+      for(int round = 0; round < NUM_ROUNDS; round++)
+      {
+        int           num_contacts = round % (TEST_MAX_CONTACTS + 1);
+        int           size         = testMakeContacts(buf, mask, num_contacts);
+        unsigned char *expected_end;
+        unsigned char *decoded_end;
+
+        // Fields outside the mask are left alone by both, so they have to start out equal
+        memset(expected, 0, sizeof(expected));
+        memset(decoded, 0, sizeof(decoded));
+
+        expected_end = referenceDecodeContacts(&device, buf, mask, expected, num_contacts);
+        decoded_end  = _senselContactDecoders[mask](&device, buf, decoded, num_contacts);
+
+        if(expected_end != buf + size || decoded_end != expected_end)
+        {
+          printf("mask %2d: decoder read %d bytes, expected %d\n", mask, (int)(decoded_end - buf), size);
+          mask_failures++;
+        }
+        for(int i = 0; i < num_contacts; i++)
+        {
+          if(memcmp(&expected[i], &decoded[i], sizeof(SenselContact)) != 0)
+          {
+            printf("mask %2d: contact %d of %d differs (unit shifts %d %d %d %d)\n", mask, i, num_contacts,
+                   unit_shifts[s][0], unit_shifts[s][1], unit_shifts[s][2], unit_shifts[s][3]);
+            mask_failures++;
+          }
+        }
+      }
+    }
+
+    printf("mask %2d: %s\n", mask, mask_failures ? "FAIL" : "ok");
+    failures += mask_failures;
+  }
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+
+// Exercises async reads of frames that arrive in pieces. A read must take what has fully arrived and return,
+// leaving a partial frame for a later call, whatever the size of the frame.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "sensel_test_device.h"
+
+#define SPLIT_GAP_US    100000
+#define RUN_US          500000
+
+static int failures = 0;
+
+#define CHECK(cond)                                                       \
+  do                                                                      \
+  {                                                                       \
+    if(!(cond))                                                           \
+    {                                                                     \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                         \
+    }                                                                     \
+  } while(0)
+
+static long long nowUS(void)
+{
+  long long time_us;
+
+  senselGetHostTime(&time_us);
+  return time_us;
+}
+
+//////////////////////////////////////
+// Frames bigger than the initial receive ring are left partial as well
+
+static void testLargeSplitFrames(int num_contacts)
+{
+  TestDevice      *device = testDeviceStart("test-large", 17);
+  SENSEL_HANDLE   handle  = NULL;
+  SenselFrameData *frame  = NULL;
+  SenselStats     stats;
+  long long       start_us;
+  long long       longest_us = 0;
+  unsigned int    frames     = 0;
+  unsigned int    bad        = 0;
+
+  CHECK(device != NULL);
+  if(!device)
+    return;
+
+  testDeviceSetContacts(device, num_contacts, num_contacts);
+  testDeviceSplitFrames(device, SPLIT_GAP_US);
+
+  if(senselOpenDeviceByTransport(&handle, SENSEL_TRANSPORT_MEMORY_PIPE, "test-large") != SENSEL_OK ||
+     senselSetFrameContent(handle, FRAME_CONTENT_CONTACTS_MASK) != SENSEL_OK ||
+     senselSetContactsMask(handle, CONTACT_MASK_ELLIPSE | CONTACT_MASK_DELTAS | CONTACT_MASK_BOUNDING_BOX | CONTACT_MASK_PEAK) != SENSEL_OK ||
+     senselSetScanMode(handle, SCAN_MODE_ASYNC) != SENSEL_OK ||
+     senselAllocateFrameData(handle, &frame) != SENSEL_OK)
+  {
+    CHECK(0);
+    if(handle)
+      senselClose(handle);
+    testDeviceStop(device);
+    return;
+  }
+
+  senselStartScanning(handle);
+  start_us = nowUS();
+  while(nowUS() - start_us < RUN_US)
+  {
+    unsigned int  num_frames = 0;
+    long long     read_us    = nowUS();
+
+    CHECK(senselReadSensor(handle) == SENSEL_OK);
+    read_us = nowUS() - read_us;
+    if(read_us > longest_us)
+      longest_us = read_us;
+
+    senselGetNumAvailableFrames(handle, &num_frames);
+    while(num_frames-- > 0)
+    {
+      senselGetFrame(handle, frame);
+      frames++;
+      if(frame->n_contacts != num_contacts)
+        bad++;
+    }
+  }
+
+  senselGetStats(handle, &stats);
+  CHECK(frames > 0);
+  CHECK(bad == 0);
+  CHECK(stats.protocol_errors == 0 && stats.failed_reads == 0);
+  // Waiting on the rest of a frame would take the whole gap between its pieces
+  CHECK(longest_us < SPLIT_GAP_US / 4);
+
+  senselStopScanning(handle);
+  senselFreeFrameData(handle, frame);
+  senselClose(handle);
+  testDeviceStop(device);
+  printf("split frames of %d contacts: %u frames, longest read %lld us\n", num_contacts, frames, longest_us);
+}
+
+int main(void)
+{
+  testLargeSplitFrames(TEST_DEVICE_MAX_CONTACTS);
+  testLargeSplitFrames(255);
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
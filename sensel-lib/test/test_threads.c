@@ -0,0 +1,505 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// Exercises the threading rules of sensel.h against simulated devices: handles driven from separate threads,
+// the capture thread against its consumer, the frame callback against register access, and senselClose
+// while capturing. Run make test TESTSANITIZE=-fsanitize=thread to have data races reported as well.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "sensel_test_device.h"
+
+#define RUN_US          500000
+#define NUM_HANDLES     4
+
+static int failures = 0;
+
+#define CHECK(cond)                                                       \
+  do                                                                      \
+  {                                                                       \
+    if(!(cond))                                                           \
+    {                                                                     \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                         \
+    }                                                                     \
+  } while(0)
+
+static long long nowUS(void)
+{
+  long long time_us;
+
+  senselGetHostTime(&time_us);
+  return time_us;
+}
+
+static void sleepUS(long us)
+{
+  struct timespec t = {us / 1000000, (us % 1000000) * 1000};
+
+  nanosleep(&t, NULL);
+}
+
+static SENSEL_HANDLE openDeviceOn(SenselTransportType type, const char *address, SenselScanMode mode)
+{
+  SENSEL_HANDLE handle = NULL;
+
+  if(senselOpenDeviceByTransport(&handle, type, address) != SENSEL_OK)
+    return NULL;
+  if(senselSetFrameContent(handle, FRAME_CONTENT_CONTACTS_MASK) != SENSEL_OK ||
+     senselSetContactsMask(handle, CONTACT_MASK_ELLIPSE | CONTACT_MASK_PEAK) != SENSEL_OK ||
+     senselSetScanMode(handle, mode) != SENSEL_OK)
+  {
+    senselClose(handle);
+    return NULL;
+  }
+  return handle;
+}
+
+static SENSEL_HANDLE openDevice(const char *name, SenselScanMode mode)
+{
+  return openDeviceOn(SENSEL_TRANSPORT_MEMORY_PIPE, name, mode);
+}
+
+//////////////////////////////////////
+// One thread per handle
+
+typedef struct
+{
+  char                name[32];
+  SenselScanMode      mode;
+  unsigned int        frames;
+  unsigned int        bad;
+  unsigned int        register_errors;
+  unsigned long long  accounted;
+  SenselStats         stats;
+  int                 opened;
+} HandleThread;
+
+static void *handleThread(void *arg)
+{
+  HandleThread    *t = (HandleThread *)arg;
+  SENSEL_HANDLE   handle;
+  SenselFrameData *frame;
+  unsigned int    num_frames;
+  unsigned char   content;
+  long long       start_us;
+  int             reads = 0;
+
+  handle = openDevice(t->name, t->mode);
+  if(!handle)
+    return NULL;
+  t->opened = 1;
+
+  senselAllocateFrameData(handle, &frame);
+  senselStartScanning(handle);
+
+  start_us = nowUS();
+  while(nowUS() - start_us < RUN_US)
+  {
+    senselReadSensor(handle);
+    senselGetNumAvailableFrames(handle, &num_frames);
+    while(num_frames-- > 0)
+    {
+      if(senselGetFrame(handle, frame) != SENSEL_OK)
+        continue;
+      t->frames++;
+      t->accounted += 1 + frame->lost_frame_count;
+      if(!testFrameIsIntact(frame))
+        t->bad++;
+    }
+    if(++reads % 16 == 0 && (senselGetFrameContent(handle, &content) != SENSEL_OK || content != FRAME_CONTENT_CONTACTS_MASK))
+      t->register_errors++;
+    if(t->mode == SCAN_MODE_ASYNC)
+      sleepUS(500);
+  }
+
+  senselGetStats(handle, &t->stats);
+  senselStopScanning(handle);
+  senselFreeFrameData(handle, frame);
+  senselClose(handle);
+  return NULL;
+}
+
+static void testHandlesOnThreads(SenselScanMode mode)
+{
+  TestDevice    *devices[NUM_HANDLES];
+  HandleThread  threads[NUM_HANDLES];
+  pthread_t     ids[NUM_HANDLES];
+  int           i;
+
+  memset(threads, 0, sizeof(threads));
+  for(i = 0; i < NUM_HANDLES; i++)
+  {
+    snprintf(threads[i].name, sizeof(threads[i].name), "test-handle-%d", i);
+    threads[i].mode = mode;
+    devices[i] = testDeviceStart(threads[i].name, i + 1);
+    CHECK(devices[i] != NULL);
+  }
+
+  for(i = 0; i < NUM_HANDLES; i++)
+    pthread_create(&ids[i], NULL, handleThread, &threads[i]);
+  for(i = 0; i < NUM_HANDLES; i++)
+    pthread_join(ids[i], NULL);
+
+  for(i = 0; i < NUM_HANDLES; i++)
+  {
+    CHECK(threads[i].opened);
+    CHECK(threads[i].frames > 0);
+    CHECK(threads[i].bad == 0);
+    CHECK(threads[i].register_errors == 0);
+    CHECK(threads[i].stats.protocol_errors == 0);
+    CHECK(threads[i].accounted <= threads[i].stats.frames_received);
+    testDeviceStop(devices[i]);
+  }
+  printf("handles on threads (%s): %u frames on the first handle\n", mode == SCAN_MODE_ASYNC ? "async" : "sync",
+         threads[0].frames);
+}
+
+//////////////////////////////////////
+// Capture thread against its consumer
+
+typedef struct
+{
+  SENSEL_HANDLE       handle;
+  int                 done;
+  int                 max_frames;       // Stop consuming after this many frames, 0 for no limit
+  unsigned int        frames;
+  unsigned int        bad;
+  unsigned long long  accounted;
+} Consumer;
+
+static void *consumerThread(void *arg)
+{
+  Consumer        *c = (Consumer *)arg;
+  SenselFrameData *frame;
+
+  while(!__atomic_load_n(&c->done, __ATOMIC_ACQUIRE))
+  {
+    if(senselAcquireCapturedFrame(c->handle, &frame) != SENSEL_OK)
+    {
+      sleepUS(200);
+      continue;
+    }
+    c->frames++;
+    c->accounted += 1 + frame->lost_frame_count;
+    if(!testFrameIsIntact(frame))
+      c->bad++;
+    // A slow consumer, so that the queue fills up and frames get dropped
+    if(c->frames % 64 == 0)
+      sleepUS(5000);
+    senselReleaseCapturedFrame(c->handle);
+    if(c->max_frames && (int)c->frames >= c->max_frames)
+      break;
+  }
+
+  // Frames already queued can still be taken once the capture has stopped
+  while(senselAcquireCapturedFrame(c->handle, &frame) == SENSEL_OK)
+  {
+    c->frames++;
+    c->accounted += 1 + frame->lost_frame_count;
+    if(!testFrameIsIntact(frame))
+      c->bad++;
+    senselReleaseCapturedFrame(c->handle);
+  }
+  return NULL;
+}
+
+typedef struct
+{
+  SENSEL_HANDLE       handle;
+  int                 done;
+  unsigned int        polls;
+  unsigned int        errors;
+  unsigned long long  last_received;
+  unsigned int        went_back;
+} StatsPoller;
+
+// senselGetStats may be called while the capture thread owns the handle
+static void *statsThread(void *arg)
+{
+  StatsPoller *p = (StatsPoller *)arg;
+  SenselStats stats;
+
+  while(!__atomic_load_n(&p->done, __ATOMIC_ACQUIRE))
+  {
+    if(senselGetStats(p->handle, &stats) != SENSEL_OK)
+      p->errors++;
+    else if(stats.frames_received < p->last_received)
+      p->went_back++;
+    else
+      p->last_received = stats.frames_received;
+    p->polls++;
+    sleepUS(100);
+  }
+  return NULL;
+}
+
+static void testCaptureConsumer(SenselScanMode mode)
+{
+  TestDevice    *device = testDeviceStart("test-capture", 7);
+  SENSEL_HANDLE handle  = openDevice("test-capture", mode);
+  Consumer      consumer;
+  StatsPoller   poller;
+  SenselStats   stats;
+  pthread_t     consumer_id;
+  pthread_t     poller_id;
+
+  CHECK(device && handle);
+  if(!device || !handle)
+    return;
+
+  memset(&consumer, 0, sizeof(consumer));
+  memset(&poller, 0, sizeof(poller));
+  consumer.handle = handle;
+  poller.handle   = handle;
+
+  senselStartScanning(handle);
+  CHECK(senselStartCapture(handle, 8) == SENSEL_OK);
+  pthread_create(&consumer_id, NULL, consumerThread, &consumer);
+  pthread_create(&poller_id, NULL, statsThread, &poller);
+
+  sleepUS(RUN_US);
+
+  // Stopped from this thread while the consumer is still taking frames
+  CHECK(senselStopCapture(handle) == SENSEL_OK);
+  CHECK(senselStopCapture(handle) != SENSEL_OK);
+  __atomic_store_n(&consumer.done, 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&poller.done, 1, __ATOMIC_RELEASE);
+  pthread_join(consumer_id, NULL);
+  pthread_join(poller_id, NULL);
+
+  senselGetStats(handle, &stats);
+  CHECK(consumer.frames > 0);
+  CHECK(consumer.bad == 0);
+  CHECK(consumer.accounted <= stats.frames_received);
+  CHECK(consumer.frames + stats.capture_drops <= stats.frames_received);
+  CHECK(stats.protocol_errors == 0);
+  CHECK(poller.polls > 0 && poller.errors == 0 && poller.went_back == 0);
+
+  // The handle is back with the application
+  CHECK(senselReadSensor(handle) == SENSEL_OK);
+  senselStopScanning(handle);
+  senselClose(handle);
+  testDeviceStop(device);
+  printf("capture against consumer (%s): %u frames taken, %u dropped\n", mode == SCAN_MODE_ASYNC ? "async" : "sync",
+         consumer.frames, stats.capture_drops);
+}
+
+// A frame that has only partly arrived must leave the capture thread blocked on the link, not spinning.
+// A socket is used as a zero timeout poll on it never sleeps, so a spinning thread shows in the cpu time.
+static void testCaptureSplitFrames(void)
+{
+  char            path[64];
+  TestDevice      *device;
+  SENSEL_HANDLE   handle;
+  SenselStats     stats;
+  struct timespec cpu_start;
+  struct timespec cpu_end;
+  long long       cpu_us;
+
+  snprintf(path, sizeof(path), "/tmp/sensel-test-split-%d.sock", (int)getpid());
+  device = testDeviceStartSocket(path, 9);
+  handle = device ? openDeviceOn(SENSEL_TRANSPORT_UNIX_SOCKET, path, SCAN_MODE_ASYNC) : NULL;
+  CHECK(device && handle);
+  if(device && !handle)
+    testDeviceStop(device);
+  if(!device || !handle)
+    return;
+
+  testDeviceSplitFrames(device, 5000);
+  senselStartScanning(handle);
+  CHECK(senselStartCapture(handle, 8) == SENSEL_OK);
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+  sleepUS(RUN_US);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+  cpu_us = (cpu_end.tv_sec - cpu_start.tv_sec) * 1000000LL + (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1000;
+
+  CHECK(senselStopCapture(handle) == SENSEL_OK);
+  senselGetStats(handle, &stats);
+  CHECK(stats.frames_received > 0);
+  CHECK(stats.protocol_errors == 0);
+  // A thread spinning on the partial frames would use up the whole run
+  CHECK(cpu_us < RUN_US / 4);
+
+  senselStopScanning(handle);
+  senselClose(handle);
+  testDeviceStop(device);
+  printf("capture of split frames: %llu frames, %lld us of cpu\n", stats.frames_received, cpu_us);
+}
+
+//////////////////////////////////////
+// senselClose while capturing
+
+static void testCloseWhileCapturing(void)
+{
+  TestDevice      *device = testDeviceStart("test-close", 11);
+  SENSEL_HANDLE   handle  = openDevice("test-close", SCAN_MODE_ASYNC);
+  Consumer        consumer;
+  pthread_t       consumer_id;
+  int             round;
+
+  CHECK(device && handle);
+  if(!device || !handle)
+    return;
+
+  for(round = 0; round < 3; round++)
+  {
+    // The consumer gives the queue back after some frames, the capture thread is still running when the
+    // handle is closed
+    memset(&consumer, 0, sizeof(consumer));
+    consumer.handle     = handle;
+    consumer.max_frames = 50;
+
+    senselStartScanning(handle);
+    CHECK(senselStartCapture(handle, 4) == SENSEL_OK);
+    pthread_create(&consumer_id, NULL, consumerThread, &consumer);
+    pthread_join(consumer_id, NULL);
+    CHECK(consumer.frames >= 50);
+    CHECK(consumer.bad == 0);
+
+    CHECK(senselClose(handle) == SENSEL_OK);
+
+    // The device can be opened again right away
+    handle = openDevice("test-close", SCAN_MODE_ASYNC);
+    CHECK(handle != NULL);
+    if(!handle)
+      break;
+  }
+
+  if(handle)
+    senselClose(handle);
+  testDeviceStop(device);
+  printf("close while capturing: %d rounds\n", round);
+}
+
+//////////////////////////////////////
+// Frame callback against register access
+
+typedef struct
+{
+  SENSEL_HANDLE       handle;
+  int                 depth;
+  int                 max_depth;
+  unsigned int        frames;
+  unsigned int        bad;
+  unsigned int        register_errors;
+  unsigned long long  accounted;
+} CallbackState;
+
+static void frameCallback(SENSEL_HANDLE handle, SenselFrameData *frame, void *user_data)
+{
+  CallbackState *s = (CallbackState *)user_data;
+  unsigned char content;
+
+  if(++s->depth > s->max_depth)
+    s->max_depth = s->depth;
+
+  s->frames++;
+  s->accounted += 1 + frame->lost_frame_count;
+  if(!testFrameIsIntact(frame))
+    s->bad++;
+
+  // Register transactions from inside the callback, which may receive more frames while they wait
+  if(senselSetLEDBrightness(handle, s->frames % 16, s->frames % 256) != SENSEL_OK)
+    s->register_errors++;
+  if(s->frames % 4 == 0 && (senselGetFrameContent(handle, &content) != SENSEL_OK || content != FRAME_CONTENT_CONTACTS_MASK))
+    s->register_errors++;
+
+  s->depth--;
+}
+
+static void testCallbackRegisters(SenselScanMode mode)
+{
+  TestDevice      *device = testDeviceStart("test-callback", 13);
+  SENSEL_HANDLE   handle  = openDevice("test-callback", mode);
+  CallbackState   state;
+  SenselFrameData *frame;
+  SenselStats     stats;
+  unsigned int    queued = 0;
+  unsigned int    num_frames;
+  unsigned short  max_rate;
+  long long       start_us;
+  int             reads = 0;
+
+  CHECK(device && handle);
+  if(!device || !handle)
+    return;
+
+  memset(&state, 0, sizeof(state));
+  state.handle = handle;
+  senselAllocateFrameData(handle, &frame);
+  senselStartScanning(handle);
+  CHECK(senselSetFrameCallback(handle, frameCallback, &state, 0) == SENSEL_OK);
+
+  start_us = nowUS();
+  while(nowUS() - start_us < RUN_US)
+  {
+    CHECK(senselReadSensor(handle) == SENSEL_OK);
+    // Register access between reads, with frames arriving in async mode
+    if(++reads % 8 == 0 && senselGetMaxFrameRate(handle, &max_rate) != SENSEL_OK)
+      state.register_errors++;
+    if(mode == SCAN_MODE_ASYNC)
+      sleepUS(500);
+  }
+
+  senselSetFrameCallback(handle, NULL, NULL, 0);
+  senselGetNumAvailableFrames(handle, &num_frames);
+  while(num_frames-- > 0)
+    if(senselGetFrame(handle, frame) == SENSEL_OK)
+      queued++;
+  senselGetStats(handle, &stats);
+
+  CHECK(state.frames > 0);
+  CHECK(state.max_depth == 1);
+  CHECK(state.bad == 0);
+  CHECK(state.register_errors == 0);
+  CHECK(stats.protocol_errors == 0);
+  CHECK(stats.lost_frames == 0);
+  CHECK(state.frames + queued == stats.frames_received);
+  CHECK(stats.frames_received <= testDeviceFramesSent(device));
+
+  senselStopScanning(handle);
+  senselFreeFrameData(handle, frame);
+  senselClose(handle);
+  testDeviceStop(device);
+  printf("callback against register access (%s): %u frames\n", mode == SCAN_MODE_ASYNC ? "async" : "sync",
+         state.frames);
+}
+
+int main(void)
+{
+  testHandlesOnThreads(SCAN_MODE_SYNC);
+  testHandlesOnThreads(SCAN_MODE_ASYNC);
+  testCaptureConsumer(SCAN_MODE_SYNC);
+  testCaptureConsumer(SCAN_MODE_ASYNC);
+  testCaptureSplitFrames();
+  testCloseWhileCapturing();
+  testCallbackRegisters(SCAN_MODE_SYNC);
+  testCallbackRegisters(SCAN_MODE_ASYNC);
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+/******************************************************************************************
+* MIT License
+*
+* Copyright (c) 2013-2017 Sensel, Inc.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************************/
+
+// Exercises the Unix socket transport against a simulated device behind a socket. A peer that hangs up
+// must turn into failing calls on the handle, not a SIGPIPE that kills the process, and a handle marked
+// disconnected by another thread must stop waiting on its link right away.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "sensel_test_device.h"
+#include "sensel_serial.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                       \
+  do                                                                      \
+  {                                                                       \
+    if(!(cond))                                                           \
+    {                                                                     \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                         \
+    }                                                                     \
+  } while(0)
+
+//////////////////////////////////////
+// A register write to a peer that went away fails
+
+static void testPeerHangUp(void)
+{
+  char            path[64];
+  TestDevice      *device;
+  SENSEL_HANDLE   handle      = NULL;
+  unsigned char   brightness  = 100;
+
+  snprintf(path, sizeof(path), "/tmp/sensel-test-%d.sock", (int)getpid());
+  device = testDeviceStartSocket(path, 13);
+  CHECK(device != NULL);
+  if(!device)
+    return;
+
+  CHECK(senselOpenDeviceByTransport(&handle, SENSEL_TRANSPORT_UNIX_SOCKET, path) == SENSEL_OK);
+  if(!handle)
+  {
+    testDeviceStop(device);
+    return;
+  }
+  CHECK(senselWriteReg(handle, SENSEL_REG_LED_BRIGHTNESS, 1, &brightness) == SENSEL_OK);
+
+  testDeviceStop(device);
+
+  CHECK(senselWriteReg(handle, SENSEL_REG_LED_BRIGHTNESS, 1, &brightness) == SENSEL_ERROR);
+  CHECK(senselWriteReg(handle, SENSEL_REG_LED_BRIGHTNESS, 1, &brightness) == SENSEL_ERROR);
+  CHECK(senselClose(handle) == SENSEL_OK);
+  printf("peer hang up: register writes fail\n");
+}
+
+//////////////////////////////////////
+// A wait blocked on the link ends when a hotplug removal marks the handle disconnected
+
+typedef struct
+{
+  const char  *path;
+  long long   marked_us;
+} Remover;
+
+static long long nowUS(void)
+{
+  long long time_us;
+
+  senselGetHostTime(&time_us);
+  return time_us;
+}
+
+static void *removerThread(void *arg)
+{
+  Remover         *remover = (Remover *)arg;
+  struct timespec delay    = {0, 100000000L};
+
+  nanosleep(&delay, NULL);
+  remover->marked_us = nowUS();
+  senselSerialMarkDisconnected(remover->path);
+  return NULL;
+}
+
+static void testRemovalWakesWait(void)
+{
+  char            path[64];
+  TestDevice      *device;
+  SENSEL_HANDLE   handle      = NULL;
+  SenselFrameData *frame      = NULL;
+  Remover         remover;
+  pthread_t       remover_id;
+  long long       woke_us;
+  unsigned char   connected   = 1;
+
+  snprintf(path, sizeof(path), "/tmp/sensel-test-wake-%d.sock", (int)getpid());
+  device = testDeviceStartSocket(path, 19);
+  CHECK(device != NULL);
+  if(!device)
+    return;
+
+  // The device sends the start of a frame and then stalls, so the wait blocks on the link for the rest
+  testDeviceSplitFrames(device, 1000000);
+  if(senselOpenDeviceByTransport(&handle, SENSEL_TRANSPORT_UNIX_SOCKET, path) != SENSEL_OK ||
+     senselSetScanMode(handle, SCAN_MODE_ASYNC) != SENSEL_OK ||
+     senselAllocateFrameData(handle, &frame) != SENSEL_OK)
+  {
+    CHECK(0);
+    if(handle)
+      senselClose(handle);
+    testDeviceStop(device);
+    return;
+  }
+  senselStartScanning(handle);
+
+  // Take the first frame, the start of the next one follows right away
+  CHECK(senselWaitForFrame(handle, 5000) == SENSEL_OK);
+  CHECK(senselGetFrame(handle, frame) == SENSEL_OK);
+
+  remover.path      = path;
+  remover.marked_us = 0;
+  pthread_create(&remover_id, NULL, removerThread, &remover);
+  CHECK(senselWaitForFrame(handle, 5000) == SENSEL_ERROR);
+  woke_us = nowUS();
+  pthread_join(remover_id, NULL);
+
+  CHECK(remover.marked_us > 0);
+  CHECK(woke_us - remover.marked_us < 500000);
+  CHECK(senselIsDeviceConnected(handle, &connected) == SENSEL_OK && connected == 0);
+
+  senselFreeFrameData(handle, frame);
+  senselClose(handle);
+  testDeviceStop(device);
+  printf("removal wakes wait: woke %lld us after the mark\n", woke_us - remover.marked_us);
+}
+
+int main(void)
+{
+  testPeerHangUp();
+  testRemovalWakesWait();
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}